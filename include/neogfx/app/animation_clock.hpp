@@ -0,0 +1,84 @@
+// animation_clock.hpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <map>
+#include <optional>
+#include <functional>
+#include <neolib/timer.hpp>
+
+namespace neogfx
+{
+	// A single app-wide timer that advances all running animations together; the timer only
+	// runs while at least one animation is subscribed.
+	class animation_clock
+	{
+	public:
+		typedef std::function<void()> callback;
+		typedef uint64_t cookie;
+	public:
+		struct no_instance : std::logic_error { no_instance() : std::logic_error("neogfx::animation_clock::no_instance") {} };
+		struct instance_exists : std::logic_error { instance_exists() : std::logic_error("neogfx::animation_clock::instance_exists") {} };
+	private:
+		typedef std::map<cookie, callback> subscriber_list;
+	public:
+		static const uint32_t DefaultInterval = 20u;
+	public:
+		animation_clock(neolib::async_task& aIoTask, uint32_t aInterval = DefaultInterval);
+		~animation_clock();
+		static bool has_instance();
+		static animation_clock& instance();
+	public:
+		uint32_t interval() const;
+		uint64_t ticks() const;
+		std::size_t subscriber_count() const;
+	public:
+		cookie subscribe(callback aCallback);
+		void unsubscribe(cookie aCookie);
+	private:
+		void tick();
+	private:
+		static animation_clock* sInstance;
+		uint32_t iInterval;
+		neolib::callback_timer iTimer;
+		subscriber_list iSubscribers;
+		cookie iNextCookie;
+		uint64_t iTicks;
+		bool iTicking;
+	};
+
+	// An animation driven by the app's animation_clock; the callback is called once per clock tick
+	// between start() and stop().
+	class animation
+	{
+	public:
+		animation(animation_clock::callback aCallback);
+		animation(const animation&) = delete;
+		~animation();
+	public:
+		bool running() const;
+		void start();
+		void stop();
+	private:
+		animation_clock::callback iCallback;
+		std::optional<animation_clock::cookie> iCookie;
+	};
+}
@@ -38,6 +38,7 @@
 #include <neogfx/app/action.hpp>
 #include <neogfx/app/i_mnemonic.hpp>
 #include <neogfx/app/i_help.hpp>
+#include <neogfx/app/animation_clock.hpp>
 
 namespace neogfx
 {
@@ -191,6 +192,7 @@ namespace neogfx
 		i_action& iActionPaste;
 		i_action& iActionDelete;
 		i_action& iActionSelectAll;
+		animation_clock iAnimationClock;
 		neolib::callback_timer iStandardActionManager;
 		mnemonic_list iMnemonics;
 		event_processing_context iAppContext;
@@ -39,6 +39,8 @@ namespace neogfx
 		virtual bool has_text() const;
 		virtual std::string text() const;
 		virtual void set_text(const std::string& aText);
+		virtual bool has_html() const;
+		virtual std::string html() const;
 	public:
 		virtual void cut();
 		virtual void copy();
@@ -62,6 +62,8 @@ namespace neogfx
 		virtual bool has_text() const = 0;
 		virtual std::string text() const = 0;
 		virtual void set_text(const std::string& aText) = 0;
+		virtual bool has_html() const = 0;
+		virtual std::string html() const = 0;
 	public:
 		virtual void cut() = 0;
 		virtual void copy() = 0;
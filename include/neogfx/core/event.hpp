@@ -227,6 +227,10 @@ namespace neogfx
 		{
 			instance().accepted = false;
 		}
+		bool has_subscribers() const
+		{
+			return has_instance() && !instance().handlers.empty();
+		}
 	public:
 		handle subscribe(const handler_callback& aHandlerCallback, const void* aUniqueId = 0) const
 		{
@@ -321,16 +321,55 @@ namespace neogfx
 		string iContent;
 	};
 
+	/* html reads a document as a stream of start tag, end tag and text events; a visitor receives each event as it is
+	   parsed so nothing resembling a DOM is built. Element and attribute names are lower case, character references
+	   are decoded and the contents of script and style elements are passed through as raw text. */
 	class html
 	{
+	public:
+		typedef std::vector<std::pair<std::string, std::string>> attribute_list;
+		class i_visitor
+		{
+		public:
+			virtual ~i_visitor() {}
+		public:
+			virtual void start_element(const std::string& aName, const attribute_list& aAttributes, bool aEmpty) = 0;
+			virtual void end_element(const std::string& aName) = 0;
+			virtual void text(const std::string& aText) = 0;
+		};
 	public:
 		struct failed_to_open_html : std::runtime_error { failed_to_open_html() : std::runtime_error("neogfx::html::failed_to_open_html") {} };
 	public:
 		html(const std::string& aFragment);
 		html(std::istream& aDocument);
+		html(const std::string& aFragment, i_visitor& aVisitor);
+		html(std::istream& aDocument, i_visitor& aVisitor);
+	public:
+		static std::string escape(const std::string& aText);
 	private:
-		void parse();
+		enum class state
+		{
+			Text,
+			Tag,
+			Comment,
+			RawText
+		};
 	private:
-		std::shared_ptr<std::istream> iDocument;
+		void parse(std::istream& aDocument);
+		void parse(const char* aBegin, const char* aEnd);
+		void finish();
+		void flush_text();
+		void process_tag();
+		static void decode(std::string& aText);
+	private:
+		i_visitor* iVisitor;
+		state iState;
+		std::string iText;
+		std::string iTag;
+		char iQuote;
+		uint32_t iDashes;
+		std::string iRawTextEnd;
+		std::string iName;
+		attribute_list iAttributes;
 	};
 }
@@ -77,6 +77,19 @@ namespace neogfx
 
 	typedef neolib::variant<colour, gradient, texture, std::pair<texture, rect>, sub_texture, std::pair<sub_texture, rect>> brush;
 
+	struct text_line_metrics
+	{
+		glyph::source_type source;	// code point range of the line within the measured text
+		size extents;
+		dimension baseline;			// distance from the top of the line to its baseline
+	};
+
+	struct text_metrics
+	{
+		size extents;
+		std::vector<text_line_metrics> lines;
+	};
+
 	inline brush to_brush(const colour_or_gradient& aEffectColour)
 	{
 		if (std::holds_alternative<colour>(aEffectColour))
@@ -426,12 +439,19 @@ namespace neogfx
 		size text_extent(string::const_iterator aTextBegin, string::const_iterator aTextEnd, const font& aFont, const glyph_text_cache_usage& aCacheUsage = DontUseGlyphTextCache) const;
 		size multiline_text_extent(const string& aText, const font& aFont, const glyph_text_cache_usage& aCacheUsage = DontUseGlyphTextCache) const;
 		size multiline_text_extent(const string& aText, const font& aFont, dimension aMaxWidth, const glyph_text_cache_usage& aCacheUsage = DontUseGlyphTextCache) const;
+		text_metrics measure_text(const string& aText, const font& aFont) const;
+		text_metrics measure_multiline_text(const string& aText, const font& aFont, dimension aMaxWidth = 0.0) const;
 		glyph_text to_glyph_text(const string& aText, const font& aFont) const;
 		glyph_text to_glyph_text(string::const_iterator aTextBegin, string::const_iterator aTextEnd, const font& aFont) const;
 		glyph_text to_glyph_text(string::const_iterator aTextBegin, string::const_iterator aTextEnd, std::function<font(std::string::size_type)> aFontSelector) const;
 		glyph_text to_glyph_text(const std::u32string& aText, const font& aFont) const;
 		glyph_text to_glyph_text(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, const font& aFont) const;
 		glyph_text to_glyph_text(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, std::function<font(std::u32string::size_type)> aFontSelector) const;
+		/* shape_text doesn't use glyph or emoji textures so it can be called on a worker thread with a graphics context of
+		   the worker's own, provided the fallback fonts of the fonts used have already been created. It fails for text
+		   containing emoji. Each glyph it produces must be passed to finish_shaping on the UI thread before it is drawn. */
+		bool shape_text(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, std::function<font(std::u32string::size_type)> aFontSelector, glyph_text::container& aResult) const;
+		void finish_shaping(glyph& aGlyph) const;
 		bool is_text_left_to_right(const string& aText, const font& aFont, const glyph_text_cache_usage& aCacheUsage = DontUseGlyphTextCache) const;
 		bool is_text_right_to_left(const string& aText, const font& aFont, const glyph_text_cache_usage& aCacheUsage = DontUseGlyphTextCache) const;
 		void draw_text(const point& aPoint, const string& aText, const font& aFont, const text_appearance& aAppearance, const glyph_text_cache_usage& aCacheUsage = DontUseGlyphTextCache) const;
@@ -491,7 +511,10 @@ namespace neogfx
 		// own
 	private:
 		glyph_text::container to_glyph_text_impl(string::const_iterator aTextBegin, string::const_iterator aTextEnd, std::function<font(std::string::size_type)> aFontSelector) const;
-		glyph_text::container to_glyph_text_impl(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, std::function<font(std::u32string::size_type)> aFontSelector) const;
+		glyph_text::container to_glyph_text_impl(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, std::function<font(std::u32string::size_type)> aFontSelector, bool aUseTextures = true) const;
+		const text_metrics& device_text_metrics(string::const_iterator aTextBegin, string::const_iterator aTextEnd, const font& aFont, bool aMultiline, dimension aMaxWidth) const;
+		text_metrics compute_text_metrics(const glyph_text& aGlyphText, const font& aFont, bool aMultiline, dimension aMaxWidth) const;
+		text_metrics from_device_units(const text_metrics& aMetrics) const;
 		// attributes
 	private:
 		const i_surface& iSurface;
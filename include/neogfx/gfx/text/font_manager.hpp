@@ -21,6 +21,7 @@
 
 #include <neogfx/neogfx.hpp>
 #include <set>
+#include <mutex>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include <neolib/string_utils.hpp>
@@ -31,6 +32,7 @@
 namespace neogfx
 {
 	class native_font;
+	class native_font_face;
 	class i_rendering_engine;
 
 	class fallback_font_info : public i_fallback_font_info
@@ -52,6 +54,14 @@ namespace neogfx
 		typedef std::pair<font::token, uint128_t> ref_counted_font_token;
 		typedef std::map<font, ref_counted_font_token> font_cache;
 		typedef std::unordered_map<font::token, font_cache::iterator> font_token_map;
+		struct glyph_cache_entry
+		{
+			const native_font_face* face;
+			std::pair<uint32_t, bool> glyph;
+			uint64_t atlasBytes;
+			uint64_t lastUsedFrame;
+		};
+		typedef std::list<glyph_cache_entry> glyph_cache_lru;
 	public:
 		struct error_initializing_font_library : std::runtime_error { error_initializing_font_library() : std::runtime_error("neogfx::font_manager::error_initializing_font_library") {} };
 		struct no_matching_font_found : std::runtime_error { no_matching_font_found() : std::runtime_error("neogfx::font_manager::no_matching_font_found") {} };
@@ -93,6 +103,17 @@ namespace neogfx
 		i_texture_atlas& glyph_atlas() override;
 		const i_emoji_atlas& emoji_atlas() const override;
 		i_emoji_atlas& emoji_atlas() override;
+	public:
+		const neogfx::glyph_cache_budget& glyph_cache_budget() const override;
+		void set_glyph_cache_budget(const neogfx::glyph_cache_budget& aBudget) override;
+		const neogfx::glyph_cache_statistics& glyph_cache_statistics() const override;
+		uint64_t glyph_cache_frame() const override;
+		void advance_glyph_cache_frame() override;
+	private:
+		glyph_cache_lru::iterator cache_glyph(const native_font_face& aFace, const std::pair<uint32_t, bool>& aGlyph, uint64_t aAtlasBytes);
+		void use_cached_glyph(glyph_cache_lru::iterator aEntry);
+		void uncache_glyph(glyph_cache_lru::iterator aEntry);
+		void trim_glyph_cache(uint32_t aEntriesNeeded, uint64_t aAtlasBytesNeeded);
 	private:
 		i_native_font& find_font(const std::string& aFamilyName, const std::string& aStyleName, font::point_size aSize);
 		i_native_font& find_best_font(const std::string& aFamilyName, font::style_e aStyle, font::point_size aSize);
@@ -103,10 +124,15 @@ namespace neogfx
 		FT_Library iFontLib;
 		native_font_list iNativeFonts;
 		font_family_list iFontFamilies;
+		std::recursive_mutex iFontTokenMutex;
 		font_cache iFontTokenCache;
 		font_token_map iFontTokens;
 		font::token iNextAvailableToken;
 		texture_atlas iGlyphAtlas;
 		neogfx::emoji_atlas iEmojiAtlas;
+		neogfx::glyph_cache_budget iGlyphCacheBudget;
+		neogfx::glyph_cache_statistics iGlyphCacheStatistics;
+		uint64_t iGlyphCacheFrame;
+		glyph_cache_lru iGlyphCacheLru;
 	};
 }
\ No newline at end of file
@@ -84,6 +84,11 @@ namespace neogfx
 		bool operator!=(const character_type& aRhs) const { return !(*this == aRhs); }
 	};
 
+	/* glyphs are stored in bulk (shaped text, text_edit documents, item view caches) so the representation is packed into
+	   24 bytes: only the horizontal advance is kept (shaping is horizontal so the vertical advance is always zero), the
+	   source range is a start and a 13-bit length, offsets are 12-bit whole pixels (as returned by offset()) sharing a word
+	   with the direction and category, and the visible extent is a float set once from the glyph texture when the glyph is
+	   shaped (or finished on the UI thread) so that measuring never touches the texture. */
 	class glyph
 	{
 	public:
@@ -98,39 +103,53 @@ namespace neogfx
 		typedef std::pair<uint32_t, uint32_t> source_type;
 	public:
 		glyph() :
-			iType{},
 			iValue{},
-			iFlags{},
-			iSource{}, 
+			iSourceStart{},
+			iAdvance{},
+			iVisibleExtent{},
+			iOffsetX{},
+			iOffsetY{},
+			iDirection{ pack_direction(text_direction::LTR) },
+			iCategory{ static_cast<uint8_t>(text_category::Unknown) },
 			iFontToken{},
-			iAdvance{}, 
-			iOffset{}
+			iSourceLength{},
+			iFlags{}
 		{
 		}
 		glyph(const character_type& aType, value_type aValue, source_type aSource, const neogfx::font& aFont, size aAdvance, size aOffset) :
-			iType{ aType.category, aType.direction }, 
-			iValue{ aValue }, 
-			iFlags{}, 
-			iSource{ aSource }, 
+			iValue{ aValue },
+			iSourceStart{},
+			iAdvance{ static_cast<float>(aAdvance.cx) },
+			iVisibleExtent{},
+			iOffsetX{},
+			iOffsetY{},
+			iDirection{ pack_direction(aType.direction) },
+			iCategory{ static_cast<uint8_t>(aType.category) },
 			iFontToken{ aFont },
-			iAdvance{ aAdvance },
-			iOffset{ aOffset }
+			iSourceLength{},
+			iFlags{}
 		{
+			set_source(aSource);
+			set_offset(aOffset);
 		}
 		glyph(const character_type& aType, value_type aValue) :
-			iType{ aType.category, aType.direction }, 
-			iValue{ aValue }, 
-			iFlags{}, 
-			iSource{}, 
+			iValue{ aValue },
+			iSourceStart{},
+			iAdvance{},
+			iVisibleExtent{},
+			iOffsetX{},
+			iOffsetY{},
+			iDirection{ pack_direction(aType.direction) },
+			iCategory{ static_cast<uint8_t>(aType.category) },
 			iFontToken{},
-			iAdvance{}, 
-			iOffset{}
+			iSourceLength{},
+			iFlags{}
 		{
 		}
 	public:
 		bool operator==(const glyph& aRhs) const 
 		{ 
-			return iType.category == aRhs.iType.category && iValue == aRhs.iValue; 
+			return iCategory == aRhs.iCategory && iValue == aRhs.iValue; 
 		}
 	public:
 		bool has_font() const
@@ -163,11 +182,11 @@ namespace neogfx
 		}
 		text_category category() const 
 		{ 
-			return iType.category; 
+			return static_cast<text_category>(iCategory); 
 		}
 		text_direction direction() const 
 		{ 
-			return iType.direction; 
+			return unpack_direction(iDirection); 
 		}
 	public:
 		bool left_to_right() const 
@@ -180,15 +199,15 @@ namespace neogfx
 		}
 		bool category_has_no_direction() const 
 		{ 
-			return iType.category != text_category::LTR && iType.category != text_category::RTL; 
+			return category() != text_category::LTR && category() != text_category::RTL; 
 		}
 		void set_category(text_category aCategory) 
 		{ 
-			iType.category = aCategory; 
+			iCategory = static_cast<uint8_t>(aCategory); 
 		}
 		void set_direction(text_direction aDirection) 
 		{ 
-			iType.direction = aDirection; 
+			iDirection = pack_direction(aDirection); 
 		}
 		value_type value() const 
 		{ 
@@ -198,13 +217,14 @@ namespace neogfx
 		{ 
 			iValue = aValue; 
 		}
-		const source_type& source() const 
+		source_type source() const 
 		{ 
-			return iSource; 
+			return source_type{ iSourceStart, iSourceStart + iSourceLength }; 
 		}
 		void set_source(const source_type aSource) 
 		{ 
-			iSource = aSource; 
+			iSourceStart = aSource.first;
+			iSourceLength = static_cast<uint16_t>(aSource.second > aSource.first ? std::min<uint32_t>(aSource.second - aSource.first, MaxSourceLength) : 0u);
 		}
 		void set_font(font::token aFontToken)
 		{
@@ -212,44 +232,32 @@ namespace neogfx
 		}
 		size advance(bool aRoundUp = true) const 
 		{ 
-			return aRoundUp ? (iAdvance + basic_size<float>{0.5f, 0.5f}).floor() : iAdvance; 
+			return size{ aRoundUp ? std::floor(iAdvance + 0.5f) : iAdvance, 0.0 }; 
 		}
 		void set_advance(const size& aAdvance) 
 		{ 
-			iAdvance = aAdvance; 
+			iAdvance = static_cast<float>(aAdvance.cx); 
 		}
 		size offset() const 
 		{ 
-			return (iOffset + basic_size<float>{0.5f, 0.5f}).floor(); 
+			return size{ static_cast<dimension>(iOffsetX), static_cast<dimension>(iOffsetY) }; 
 		}
 		void set_offset(const size& aOffset) 
 		{ 
-			iOffset = aOffset; 
+			iOffsetX = clamp_offset(aOffset.cx);
+			iOffsetY = clamp_offset(aOffset.cy);
 		}
 		size extents() const
 		{
-			if (iExtents == basic_size<float>{})
-			{
-				iExtents = size{ advance().cx, !is_emoji() ? font().height() : advance().cx };
-				try
-				{
-					if (has_font_glyph())
-						iExtents.cx = static_cast<float>(offset().cx + glyph_texture().placement().x + glyph_texture().texture().extents().cx);
-				}
-				catch (...)
-				{
-					// silently ignore freetype exceptions.
-				}
-			}
-			return iExtents;
+			return size{ has_font_glyph() && iVisibleExtent != 0.0f ? iVisibleExtent : advance().cx, !is_emoji() ? font().height() : advance().cx };
 		}
-		void set_extents(size& aExtents)
+		void set_visible_extent(float aVisibleExtent)
 		{
-			iExtents = aExtents;
+			iVisibleExtent = aVisibleExtent;
 		}
 		flags_e flags() const
 		{ 
-			return iFlags; 
+			return static_cast<flags_e>(iFlags); 
 		}
 		void set_flags(flags_e aFlags) 
 		{ 
@@ -261,7 +269,7 @@ namespace neogfx
 		}
 		void set_underline(bool aUnderline) 
 		{ 
-			iFlags = static_cast<flags_e>(aUnderline ? iFlags | Underline : iFlags & ~Underline); 
+			iFlags = (aUnderline ? iFlags | Underline : iFlags & ~Underline); 
 		}
 		bool subpixel() const 
 		{ 
@@ -269,7 +277,7 @@ namespace neogfx
 		}
 		void set_subpixel(bool aSubpixel) 
 		{ 
-			iFlags = static_cast<flags_e>(aSubpixel ? iFlags | Subpixel : iFlags & ~Subpixel); 
+			iFlags = (aSubpixel ? iFlags | Subpixel : iFlags & ~Subpixel); 
 		}
 		bool mnemonic() const 
 		{ 
@@ -277,7 +285,7 @@ namespace neogfx
 		}
 		void set_mnemonic(bool aMnemonic) 
 		{ 
-			iFlags = static_cast<flags_e>(aMnemonic ? iFlags | Mnemonic : iFlags & ~Mnemonic); 
+			iFlags = (aMnemonic ? iFlags | Mnemonic : iFlags & ~Mnemonic); 
 		}
 		const neogfx::font& font() const
 		{
@@ -285,21 +293,50 @@ namespace neogfx
 		}
 		void kerning_adjust(float aAdjust) 
 		{ 
-			iAdvance.cx += aAdjust; 
+			iAdvance += aAdjust; 
 		}
 		const i_glyph_texture& glyph_texture() const
 		{
 			return font().glyph_texture(*this);
 		}
 	private:
-		character_type iType;
+		static constexpr uint32_t MaxSourceLength = 0x1FFFu;
+		static constexpr int32_t MaxOffset = 0x7FF;
+		static int32_t clamp_offset(double aOffset)
+		{
+			return static_cast<int32_t>(std::max<double>(-MaxOffset, std::min<double>(MaxOffset, std::floor(aOffset + 0.5))));
+		}
+		// a direction is a base (LTR or RTL) plus at most one of the None, Digit or Emoji bits above it; keep the base and
+		// the index of that bit pair so that it fits in four bits.
+		static uint32_t pack_direction(text_direction aDirection)
+		{
+			auto const value = static_cast<uint32_t>(aDirection);
+			auto const base = value & static_cast<uint32_t>(text_direction::BaseMask);
+			uint32_t kind = 0u;
+			for (auto upper = value >> 2u; upper != 0u; upper >>= 2u)
+				++kind;
+			return base | (kind << 2u);
+		}
+		static text_direction unpack_direction(uint32_t aPacked)
+		{
+			auto const base = aPacked & static_cast<uint32_t>(text_direction::BaseMask);
+			auto const kind = aPacked >> 2u;
+			if (kind == 0u || base == 0u)
+				return static_cast<text_direction>(base);
+			return static_cast<text_direction>(base | (1u << (kind * 2u + base - 1u)));
+		}
+	private:
 		value_type iValue;
-		flags_e iFlags;
-		source_type iSource;
+		uint32_t iSourceStart;
+		float iAdvance;
+		float iVisibleExtent;
+		int32_t iOffsetX : 12;
+		int32_t iOffsetY : 12;
+		uint32_t iDirection : 4;
+		uint32_t iCategory : 4;
 		neogfx::font::scoped_token iFontToken;
-		basic_size<float> iAdvance;
-		basic_size<float> iOffset;
-		mutable basic_size<float> iExtents;
+		uint16_t iSourceLength : 13;
+		uint16_t iFlags : 3;
 	};
 
 	class glyph_text : private std::vector<glyph>
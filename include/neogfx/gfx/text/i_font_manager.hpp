@@ -30,6 +30,22 @@ namespace neogfx
 	class i_native_font;
 	class i_native_font_face;
 
+	struct glyph_cache_budget
+	{
+		uint64_t atlasBytes;		// glyph atlas space (in bytes) cached glyphs may occupy
+		uint32_t entries;			// maximum number of cached glyphs
+		uint32_t minimumAge;		// number of frames a glyph must go unused before it can be evicted
+	};
+
+	struct glyph_cache_statistics
+	{
+		uint32_t entries;
+		uint64_t atlasBytes;
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+	};
+
 	class i_fallback_font_info
 	{
 	public:
@@ -77,5 +93,11 @@ namespace neogfx
 		virtual i_texture_atlas& glyph_atlas() = 0;
 		virtual const i_emoji_atlas& emoji_atlas() const = 0;
 		virtual i_emoji_atlas& emoji_atlas() = 0;
+	public:
+		virtual const neogfx::glyph_cache_budget& glyph_cache_budget() const = 0;
+		virtual void set_glyph_cache_budget(const neogfx::glyph_cache_budget& aBudget) = 0;
+		virtual const neogfx::glyph_cache_statistics& glyph_cache_statistics() const = 0;
+		virtual uint64_t glyph_cache_frame() const = 0;
+		virtual void advance_glyph_cache_frame() = 0;
 	};
 }
\ No newline at end of file
@@ -48,7 +48,7 @@ namespace neogfx
 			};
 			rect_pack pack;
 			std::set<rect, fragment_less_than> used;
-			std::set<rect, fragment_less_than> freed; // todo: use this when bin pack is full
+			std::set<rect, fragment_less_than> freed;
 			bool insert(const size& aSize, rect& aResult)
 			{
 				if (pack.insert(aSize, aResult))
@@ -56,8 +56,18 @@ namespace neogfx
 					used.insert(aResult);
 					return true;
 				}
-				else
-					return false;
+				// bin pack is full so reuse the smallest freed fragment that is big enough
+				for (auto f = freed.lower_bound(rect{ point{ std::numeric_limits<coordinate>::lowest(), std::numeric_limits<coordinate>::lowest() }, aSize }); f != freed.end(); ++f)
+				{
+					if (f->cx >= aSize.cx && f->cy >= aSize.cy)
+					{
+						aResult = *f;
+						freed.erase(f);
+						used.insert(aResult);
+						return true;
+					}
+				}
+				return false;
 			}
 		};
 		typedef std::pair<texture, fragments> page;
@@ -42,6 +42,19 @@ namespace neogfx
 		struct column_major;
 		typedef std::map<cell_coordinates, i_layout_item*, std::less<cell_coordinates>, neolib::fast_pool_allocator<std::pair<const cell_coordinates, i_layout_item*>>> cell_list;
 		typedef std::vector<std::pair<cell_coordinates, cell_coordinates>> span_list;
+		typedef std::vector<std::pair<cell_coordinate, i_layout_item*>> cell_line;
+		typedef std::vector<cell_line> cell_lines;
+		typedef std::map<cell_coordinates, span_list::size_type> span_index;
+		// measurements of a row or column; valid for one size hint generation until the line is dirtied
+		struct line_metrics
+		{
+			generation_type generation;
+			optional_size availableSpace;
+			std::optional<bool> visible;
+			std::optional<size::dimension_type> minimum;
+			std::optional<size::dimension_type> maximum;
+		};
+		typedef std::vector<line_metrics> line_metrics_list;
 	public:
 		grid_layout(neogfx::alignment aAlignment = neogfx::alignment::Centre | neogfx::alignment::VCentre);
 		grid_layout(cell_coordinate aRows, cell_coordinate aColumns, neogfx::alignment aAlignment = neogfx::alignment::Centre | neogfx::alignment::VCentre);
@@ -71,8 +84,6 @@ namespace neogfx
 		i_layout& layout_at_position(cell_coordinate aRow, cell_coordinate aColumn);
 	public:
 		void invalidate() override;
-	public:
-		void next_layout_id() override;
 	public:
 		size minimum_size(const optional_size& aAvailableSpace = optional_size()) const override;
 		size maximum_size(const optional_size& aAvailableSpace = optional_size()) const override;
@@ -99,6 +110,9 @@ namespace neogfx
 		void increment_cursor();
 		horizontal_layout& row_layout(cell_coordinate aRow);
 		span_list::const_iterator find_span(const cell_coordinates& aCell) const;
+		void index_cell(const cell_coordinates& aCell, i_layout_item* aItem);
+		void dirty_lines(const cell_coordinates& aFrom, const cell_coordinates& aTo);
+		void dirty_all_lines();
 		void init();
 		// helpers
 	public:
@@ -112,6 +126,11 @@ namespace neogfx
 		cell_dimensions iDimensions;
 		cell_coordinates iCursor;
 		span_list iSpans;
+		cell_lines iRowCells;
+		cell_lines iColumnCells;
+		span_index iSpanIndex;
+		mutable line_metrics_list iRowMetrics;
+		mutable line_metrics_list iColumnMetrics;
 		vertical_layout iRowLayout;
 		std::vector<std::shared_ptr<horizontal_layout>> iRows;
 	};
@@ -53,9 +53,11 @@ namespace neogfx
 		virtual i_layout_item& add_at(item_index aPosition, i_layout_item& aItem) = 0;
 		virtual i_layout_item& add(std::shared_ptr<i_layout_item> aItem) = 0;
 		virtual i_layout_item& add_at(item_index aPosition, std::shared_ptr<i_layout_item> aItem) = 0;
+		virtual void add_items(const std::vector<std::shared_ptr<i_layout_item>>& aItems) = 0;
 		virtual i_spacer& add_spacer() = 0;
 		virtual i_spacer& add_spacer_at(item_index aPosition) = 0;
 		virtual void remove_at(item_index aIndex) = 0;
+		virtual void remove_items_at(item_index aFirst, item_index aLast) = 0;
 		virtual bool remove(i_layout_item& aItem) = 0;
 		virtual void remove_all() = 0;
 		virtual void move_all_to(i_layout& aDestination) = 0;
@@ -86,9 +88,6 @@ namespace neogfx
 		virtual bool invalidated() const = 0;
 		virtual void invalidate() = 0;
 		virtual void validate() = 0;
-	public:
-		virtual uint32_t layout_id() const = 0;
-		virtual void next_layout_id() = 0;
 		// helpers
 	public:
 		template <typename ItemType>
@@ -30,6 +30,8 @@ namespace neogfx
 
 	class i_layout_item : public i_geometry
 	{
+	public:
+		typedef uint32_t generation_type;
 	public:
 		struct not_a_layout : std::logic_error { not_a_layout() : std::logic_error("neogfx::i_layout_item::not_a_layout") {} };
 		struct not_a_widget : std::logic_error { not_a_widget() : std::logic_error("neogfx::i_layout_item::not_a_widget") {} };
@@ -60,5 +62,11 @@ namespace neogfx
 		virtual void layout_as(const point& aPosition, const size& aSize) = 0;
 	public:
 		virtual bool visible() const = 0;
+		// size hint generation
+	public:
+		static generation_type generation();
+		static void next_generation();
+		static void layout_pass_started();
+		static void layout_pass_completed();
 	};
 }
@@ -31,5 +31,7 @@ namespace neogfx
 		virtual const i_layout_item& subject() const = 0;
 		virtual i_layout_item& subject() = 0;
 		virtual std::shared_ptr<i_layout_item> subject_ptr() = 0;
+	public:
+		virtual void invalidate_size_hints() = 0;
 	};
 }
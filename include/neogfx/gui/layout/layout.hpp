@@ -20,8 +20,9 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
-#include <list>
+#include <unordered_map>
 #include <boost/pool/pool_alloc.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <neolib/variant.hpp>
 #include <neolib/lifetime.hpp>
 #include <neogfx/core/units_context.hpp>
@@ -38,7 +39,7 @@ namespace neogfx
 		struct item_already_added : std::logic_error { item_already_added() : std::logic_error("neogfx::layout::item_already_added") {} };
 	protected:
 		typedef layout_item item;
-		typedef std::list<item, neolib::fast_pool_allocator<item>> item_list;
+		typedef boost::ptr_vector<item> item_list;
 		enum item_type_e
 		{
 			ItemTypeNone = 0x00,
@@ -83,7 +84,9 @@ namespace neogfx
 		i_layout_item& add_at(item_index aPosition, i_layout_item& aItem) override;
 		i_layout_item& add(std::shared_ptr<i_layout_item> aItem) override;
 		i_layout_item& add_at(item_index aPosition, std::shared_ptr<i_layout_item> aItem) override;
+		void add_items(const std::vector<std::shared_ptr<i_layout_item>>& aItems) override;
 		void remove_at(item_index aIndex) override;
+		void remove_items_at(item_index aFirst, item_index aLast) override;
 		bool remove(i_layout_item& aItem) override;
 		void remove_all() override;
 		void move_all_to(i_layout& aDestination) override;
@@ -146,8 +149,6 @@ namespace neogfx
 		neogfx::units set_units(neogfx::units aUnits) const override;
 	public:
 		void layout_as(const point& aPosition, const size& aSize);
-		uint32_t layout_id() const override;
-		void next_layout_id() override;
 	public:
 		bool visible() const override;
 	protected:
@@ -173,6 +174,10 @@ namespace neogfx
 		size do_maximum_size(const optional_size& aAvailableSpace) const;
 		template <typename AxisPolicy>
 		void do_layout_items(const point& aPosition, const size& aSize);
+	private:
+		optional_item_index find_index(const i_layout_item& aItem) const;
+		void index_item(item_index aIndex) const;
+		void invalidate_item_index();
 	private:
 		i_layout* iParent;
 		mutable i_widget* iOwner;
@@ -189,8 +194,9 @@ namespace neogfx
 		optional_size iMinimumSize;
 		optional_size iMaximumSize;
 		item_list iItems;
+		mutable std::unordered_map<const i_layout_item*, item_index> iItemIndex;
+		mutable bool iItemIndexValid;
 		bool iLayoutStarted;
-		uint32_t iLayoutId;
 		bool iInvalidated;
 	};
 }
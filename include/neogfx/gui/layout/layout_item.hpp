@@ -20,12 +20,21 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <array>
 #include <neogfx/gui/layout/i_layout_item_proxy.hpp>
 
 namespace neogfx
 {
 	class layout_item : public i_layout_item_proxy
 	{
+	private:
+		struct size_hint
+		{
+			generation_type generation;
+			optional_size availableSpace;
+			size value;
+		};
+		typedef std::array<size_hint, 4> size_hint_cache;
 	public:
 		layout_item(i_layout_item& aItem);
 		layout_item(std::shared_ptr<i_layout_item> aItem);
@@ -89,12 +98,18 @@ namespace neogfx
 		const i_layout_item& subject() const override;
 		i_layout_item& subject() override;
 		std::shared_ptr<i_layout_item> subject_ptr() override;
+	public:
+		void invalidate_size_hints() override;
 	public:
 		bool operator==(const layout_item& aOther) const;
+	private:
+		static const size_hint* find_size_hint(const size_hint_cache& aCache, const optional_size& aAvailableSpace);
+		static const size& cache_size_hint(size_hint_cache& aCache, uint32_t& aNextEntry, const optional_size& aAvailableSpace, const size& aValue);
 	private:
 		std::shared_ptr<i_layout_item> iSubject;
-		mutable std::pair<uint32_t, uint32_t> iLayoutId;
-		mutable size iMinimumSize;
-		mutable size iMaximumSize;
+		mutable size_hint_cache iMinimumSize;
+		mutable size_hint_cache iMaximumSize;
+		mutable uint32_t iNextMinimumSize;
+		mutable uint32_t iNextMaximumSize;
 	};
 }
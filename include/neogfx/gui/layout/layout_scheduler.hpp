@@ -0,0 +1,73 @@
+// layout_scheduler.hpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <unordered_map>
+#include <neolib/timer.hpp>
+
+namespace neogfx
+{
+	class i_widget;
+	class i_window;
+	class pause_rendering;
+
+	// Collects deferred layout requests per window and services them with a single top-down
+	// pass on the next event loop iteration; rendering of the window is paused until then.
+	class layout_scheduler
+	{
+	public:
+		struct statistics
+		{
+			uint64_t requests;
+			uint64_t coalesced;
+			uint64_t passes;
+			uint64_t frames;
+			uint32_t lastFramePasses;
+		};
+	private:
+		struct window_queue
+		{
+			std::unique_ptr<pause_rendering> pause;
+			std::unique_ptr<neolib::callback_timer> timer;
+			std::vector<i_widget*> dirty;
+		};
+		// keyed on the root widget so that a window's entries are dropped when it is destroyed as a widget
+		typedef std::unordered_map<const i_widget*, window_queue> queue_list;
+		typedef std::unordered_map<const i_widget*, const i_widget*> scheduled_list;
+		typedef std::unordered_map<const i_widget*, statistics> statistics_list;
+	public:
+		layout_scheduler();
+		~layout_scheduler();
+		static layout_scheduler& instance();
+	public:
+		void schedule(i_widget& aWidget);
+		void cancel(const i_widget& aWidget);
+		void remove(const i_widget& aWidget);
+		bool is_scheduled(const i_widget& aWidget) const;
+		void run(i_window& aWindow);
+	public:
+		statistics stats(const i_window& aWindow) const;
+	private:
+		queue_list iQueues;
+		scheduled_list iScheduled;
+		statistics_list iStatistics;
+	};
+}
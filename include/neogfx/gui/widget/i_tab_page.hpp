@@ -32,6 +32,8 @@ namespace neogfx
 	public:
 		event<> selected;
 		event<> deselected;
+		event<> hibernating;
+		event<> waking;
 	public:
 		virtual ~i_tab_page() {}
 	public:
@@ -24,12 +24,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace neogfx
 {
+	class i_layout;
+
+	enum class lazy_tab_page_policy : uint32_t
+	{
+		Retain,
+		Destroy,
+		Hibernate
+	};
+
 	class i_tab_page_container : public i_tab_container
 	{
 	public:
 		event<i_tab_page&> selected_tab_page_changed;
 	public:
 		typedef uint32_t tab_index;
+		typedef std::function<std::shared_ptr<i_tab_page>(i_layout& aPageLayout, i_tab& aTab)> tab_page_factory;
 	public:
 		struct tab_page_not_found : std::logic_error { tab_page_not_found() : std::logic_error("neogfx::i_tab_page_container::tab_page_not_found") {} };
 	public:
@@ -42,5 +52,9 @@ namespace neogfx
 		virtual i_tab_page& add_tab_page(i_tab& aTab) = 0;
 		virtual i_tab_page& add_tab_page(i_tab& aTab, i_tab_page& aWidget) = 0;
 		virtual i_tab_page& add_tab_page(i_tab& aTab, std::shared_ptr<i_tab_page> aWidget) = 0;
+		virtual i_tab& add_lazy_tab_page(const std::string& aTabText, tab_page_factory aFactory) = 0;
+		virtual i_tab& insert_lazy_tab_page(tab_index aTabIndex, const std::string& aTabText, tab_page_factory aFactory) = 0;
+		virtual neogfx::lazy_tab_page_policy lazy_tab_page_policy() const = 0;
+		virtual void set_lazy_tab_page_policy(neogfx::lazy_tab_page_policy aPolicy, uint32_t aRetainedPages = 0u) = 0;
 	};
 }
\ No newline at end of file
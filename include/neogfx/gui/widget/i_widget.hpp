@@ -132,6 +132,7 @@ namespace neogfx
 		virtual size extents() const = 0;
 		virtual void resize(const size& aSize) = 0;
 		virtual void resized() = 0;
+		virtual void child_geometry_changed(const i_widget& aChild) = 0;
 		virtual const i_widget& get_widget_at(const point& aPosition) const = 0;
 		virtual i_widget& get_widget_at(const point& aPosition) = 0;
 		virtual widget_part hit_test(const point& aPosition) const = 0;
@@ -143,6 +144,7 @@ namespace neogfx
 		virtual bool ready_to_render() const = 0;
 		virtual void render(graphics_context& aGraphicsContext) const = 0;
 		virtual bool transparent_background() const = 0;
+		virtual bool opaque() const = 0;
 		virtual void paint_non_client(graphics_context& aGraphicsContext) const = 0;
 		virtual void paint_non_client_after(graphics_context& aGraphicsContext) const = 0;
 		virtual void paint(graphics_context& aGraphicsContext) const = 0;
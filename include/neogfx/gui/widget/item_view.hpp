@@ -20,6 +20,7 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <neogfx/app/animation_clock.hpp>
 #include "scrollable_widget.hpp"
 #include "header_view.hpp"
 #include "item_editor.hpp"
@@ -110,6 +111,7 @@ namespace neogfx
 		neogfx::scrolling_disposition scrolling_disposition() const override;
 		void update_scrollbar_visibility() override;
 		void update_scrollbar_visibility(usv_stage_e aStage) override;
+		rect scrolled_content_rect() const override;
 	protected:
 		void column_info_changed(const i_item_model& aModel, item_model_index::value_type aColumnIndex) override;
 		void item_added(const i_item_model& aModel, const item_model_index& aItemIndex) override;
@@ -141,6 +143,7 @@ namespace neogfx
 		optional_item_presentation_model_index item_at(const point& aPosition, bool aIncludeEntireRow = true) const;
 	private:
 		void init();
+		void track_mouse();
 	private:
 		sink iSink;
 		std::shared_ptr<i_item_model> iModel;
@@ -148,7 +151,7 @@ namespace neogfx
 		std::shared_ptr<i_item_selection_model> iSelectionModel;
 		bool iHotTracking;
 		bool iIgnoreNextMouseMove;
-		std::optional<neolib::callback_timer> iMouseTracker;
+		animation iMouseTracker{ [this]() { track_mouse(); } };
 		optional_item_presentation_model_index iEditing;
 		std::shared_ptr<i_item_editor> iEditor;
 		bool iBeginningEdit;
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <neogfx/app/animation_clock.hpp>
 #include <neogfx/app/i_mnemonic.hpp>
 #include <neogfx/app/i_help.hpp>
 #include <neogfx/gui/layout/horizontal_layout.hpp>
@@ -47,6 +48,7 @@ namespace neogfx
 		neogfx::size_policy size_policy() const override;
 		size minimum_size(const optional_size& aAvailableSpace = optional_size()) const override;
 	public:
+		bool opaque() const override;
 		void paint_non_client(graphics_context& aGraphicsContext) const override;
 		void paint(graphics_context& aGraphicsContext) const override;
 	public:
@@ -71,6 +73,7 @@ namespace neogfx
 		point sub_menu_position() const;
 	private:
 		void init();
+		void delayed_open_sub_menu();
 		virtual void select_item(bool aOpenAnySubMenu = false);
 	private:
 		sink iSink;
@@ -83,7 +86,8 @@ namespace neogfx
 		text_widget iText;
 		horizontal_spacer iSpacer;
 		text_widget iShortcutText;
-		std::optional<std::unique_ptr<neolib::callback_timer>> iSubMenuOpener;
+		animation iSubMenuOpener{ [this]() { delayed_open_sub_menu(); } };
+		uint64_t iSubMenuOpenerStartTime = 0u;
 		mutable std::optional<std::pair<colour, texture>> iSubMenuArrow;
 	};
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <neogfx/app/animation_clock.hpp>
 #include "button.hpp"
 #include <neogfx/gui/widget/i_push_button.hpp>
 
@@ -72,7 +73,7 @@ namespace neogfx
 	private:
 		void init();
 	private:
-		neolib::callback_timer iAnimator;
+		animation iAnimator;
 		uint32_t iAnimationFrame;
 		push_button_style iStyle;
 		optional_colour iHoverColour;
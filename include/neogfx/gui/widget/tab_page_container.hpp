@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <neolib/timer.hpp>
 #include <neogfx/gui/widget/widget.hpp>
 #include <neogfx/gui/widget/scrollable_widget.hpp>
 #include <neogfx/gui/layout/border_layout.hpp>
@@ -59,6 +60,13 @@ namespace neogfx
 	private:
 		typedef std::shared_ptr<i_tab_page> tab_page_pointer;
 		typedef std::map<const i_tab*, tab_page_pointer> tab_list;
+		struct lazy_tab_page
+		{
+			tab_page_factory factory;
+			uint64_t lastSelected;
+			bool hibernating;
+		};
+		typedef std::map<const i_tab*, lazy_tab_page> lazy_tab_page_list;
 	public:
 		tab_page_container(bool aClosableTabs = false, tab_container_style aStyle = tab_container_style::TabAlignmentTop);
 		tab_page_container(i_widget& aParent, bool aClosableTabs = false, tab_container_style aStyle = tab_container_style::TabAlignmentTop);
@@ -98,6 +106,10 @@ namespace neogfx
 		i_tab_page& add_tab_page(i_tab& aTab) override;
 		i_tab_page& add_tab_page(i_tab& aTab, i_tab_page& aWidget) override;
 		i_tab_page& add_tab_page(i_tab& aTab, std::shared_ptr<i_tab_page> aWidget) override;
+		i_tab& add_lazy_tab_page(const std::string& aTabText, tab_page_factory aFactory) override;
+		i_tab& insert_lazy_tab_page(tab_index aTabIndex, const std::string& aTabText, tab_page_factory aFactory) override;
+		neogfx::lazy_tab_page_policy lazy_tab_page_policy() const override;
+		void set_lazy_tab_page_policy(neogfx::lazy_tab_page_policy aPolicy, uint32_t aRetainedPages = 0u) override;
 	public:
 		void adding_tab(i_tab& aTab) override;
 		void selecting_tab(i_tab& aTab) override;
@@ -113,9 +125,17 @@ namespace neogfx
 		bool is_managing_layout() const override;
 	private:
 		void update_tab_bar_placement();
+		void make_lazy(i_tab& aTab, tab_page_factory aFactory);
+		void create_lazy_tab_page(i_tab& aTab);
+		void reclaim_lazy_tab_pages(const i_tab& aSelectedTab);
 	private:
 		border_layout iContainerLayout;
 		tab_bar iTabBar;
 		tab_list iTabs;
+		lazy_tab_page_list iLazyTabPages;
+		neogfx::lazy_tab_page_policy iLazyTabPagePolicy;
+		uint32_t iRetainedLazyTabPages;
+		uint64_t iLazyTabPageSelections;
+		std::unique_ptr<neolib::callback_timer> iReclaimer;
 	};
 }
\ No newline at end of file
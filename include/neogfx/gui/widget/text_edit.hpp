@@ -20,6 +20,8 @@
 #pragma once
 
 #include <neogfx/neogfx.hpp>
+#include <iosfwd>
+#include <deque>
 #include <boost/pool/pool_alloc.hpp>
 #include <neolib/tag_array.hpp>
 #include <neolib/segmented_array.hpp>
@@ -30,6 +32,7 @@
 #include "scrollable_widget.hpp"
 #include "i_text_document.hpp"
 #include "cursor.hpp"
+#include "text_search.hpp"
 
 namespace neogfx
 {
@@ -121,8 +124,31 @@ namespace neogfx
 			neogfx::margins iMargins;
 			text_edit::style iStyle;
 		};
+		class i_syntax_highlighter
+		{
+		public:
+			typedef uint32_t state_type;
+			struct style_run
+			{
+				std::size_t start;
+				std::size_t end;
+				uint32_t style;
+			};
+			typedef std::vector<style_run> style_runs;
+		public:
+			virtual ~i_syntax_highlighter() {}
+		public:
+			virtual state_type initial_state() const = 0;
+			// appends the (sorted, non-overlapping) style runs of a paragraph, given the state at its start, and returns the state at its end
+			virtual state_type highlight(const std::u32string& aParagraph, state_type aState, style_runs& aRuns) const = 0;
+			// run styles are applied when drawing so their fonts are ignored
+			virtual const text_edit::style& run_style(uint32_t aStyle) const = 0;
+		};
 	private:
 		class multiple_text_changes;
+		class text_loader;
+		class text_finder;
+		class html_importer;
 		struct unknown_node {};
 		template <typename Node = unknown_node>
 		class tag
@@ -241,6 +267,20 @@ namespace neogfx
 		{
 		public:
 			typedef std::map<document_glyphs::size_type, dimension, std::less<document_glyphs::size_type>, boost::fast_pool_allocator<std::pair<const document_glyphs::size_type, dimension>>> height_list;
+			struct wrapped_line
+			{
+				document_glyphs::size_type lineStart;
+				document_glyphs::size_type lineEnd;
+				coordinate ypos;
+				size extents;
+			};
+			typedef std::vector<wrapped_line> wrapped_lines;
+			struct highlight_info
+			{
+				i_syntax_highlighter::state_type startState;
+				i_syntax_highlighter::state_type endState;
+				i_syntax_highlighter::style_runs runs;
+			};
 		public:
 			glyph_paragraph(text_edit& aParent) :
 				iParent{&aParent}, iSelf{}
@@ -263,6 +303,9 @@ namespace neogfx
 				iParent = aOther.iParent;
 				iSelf = aOther.iSelf;
 				iHeights = aOther.iHeights;
+				iWrappedWidth = aOther.iWrappedWidth;
+				iWrapping = aOther.iWrapping;
+				iHighlight = aOther.iHighlight;
 				return *this;
 			}
 		public:
@@ -316,14 +359,15 @@ namespace neogfx
 			}
 			dimension height(document_glyphs::iterator aStart, document_glyphs::iterator aEnd) const
 			{
+				// heights are keyed on glyph index relative to the start of the paragraph so they survive edits to preceding paragraphs
+				auto const paragraphStart = iParent->iGlyphs.begin() + start_index();
 				if (iHeights.empty())
 				{
 					dimension previousHeight = 0.0;
 					auto textStartIndex = text_start_index();
-					auto glyphsStartIndex = start_index();
-					auto glyphsEndIndex = end_index();
-					auto iterGlyph = start();
-					for (auto i = glyphsStartIndex; i != glyphsEndIndex; ++i)
+					auto glyphCount = end_index() - start_index();
+					auto iterGlyph = paragraphStart;
+					for (document_glyphs::size_type i = 0; i != glyphCount; ++i)
 					{
 						const auto& glyph = *(iterGlyph++);
 						const auto& tagContents = iParent->iText.tag(iParent->iText.begin() + textStartIndex + glyph.source().first).contents();
@@ -331,29 +375,69 @@ namespace neogfx
 						dimension cy = glyph.extents().cy;
 						if (style.text_effect() != std::nullopt && style.text_effect()->type() == text_effect::Outline)
 							cy += (style.text_effect()->width() * 2.0);
-						if (i == glyphsStartIndex || cy != previousHeight)
+						if (i == 0 || cy != previousHeight)
 						{
 							iHeights[i] = cy;
 							previousHeight = cy;
 						}
 					}
-					iHeights[end_index()] = 0.0;
+					iHeights[glyphCount] = 0.0;
 				}
 				dimension result = 0.0;
-				auto start = iHeights.lower_bound(aStart - iParent->iGlyphs.begin());
-				if (start != iHeights.begin() && aStart < iParent->iGlyphs.begin() + start->first)
+				auto start = iHeights.lower_bound(aStart - paragraphStart);
+				if (start != iHeights.begin() && aStart < paragraphStart + start->first)
 					--start;
-				auto stop = iHeights.lower_bound(aEnd - iParent->iGlyphs.begin());
+				auto stop = iHeights.lower_bound(aEnd - paragraphStart);
 				if (start == stop && stop != iHeights.end())
 					++stop;
 				for (auto i = start; i != stop; ++i)
 					result = std::max(result, (*i).second);
 				return result;
 			}
+			dimension natural_width() const
+			{
+				auto const paragraphStart = start();
+				auto const paragraphEnd = end();
+				return paragraphStart != paragraphEnd ? (paragraphEnd - 1)->x + (paragraphEnd - 1)->advance().cx : 0.0;
+			}
+			bool wrapped(dimension aAvailableWidth) const
+			{
+				if (iWrappedWidth == std::nullopt)
+					return false;
+				if (*iWrappedWidth == aAvailableWidth)
+					return true;
+				// a paragraph that needs no wrapping at either width is laid out identically at both
+				auto const naturalWidth = natural_width();
+				return naturalWidth <= aAvailableWidth && naturalWidth <= *iWrappedWidth;
+			}
+			const wrapped_lines& wrapping() const
+			{
+				return iWrapping;
+			}
+			void set_wrapping(dimension aAvailableWidth, wrapped_lines&& aWrapping)
+			{
+				iWrappedWidth = aAvailableWidth;
+				iWrapping = std::move(aWrapping);
+			}
+			const std::optional<highlight_info>& highlight() const
+			{
+				return iHighlight;
+			}
+			void set_highlight(highlight_info&& aHighlight) const
+			{
+				iHighlight = std::move(aHighlight);
+			}
+			void clear_highlight() const
+			{
+				iHighlight = std::nullopt;
+			}
 		private:
 			text_edit* iParent;
 			glyph_paragraphs::const_iterator iSelf;
 			mutable height_list iHeights;
+			optional_dimension iWrappedWidth;
+			wrapped_lines iWrapping;
+			mutable std::optional<highlight_info> iHighlight;
 		};
 		struct glyph_line
 		{
@@ -362,6 +446,7 @@ namespace neogfx
 			std::pair<document_glyphs::size_type, document_glyphs::const_iterator> lineEnd;
 			coordinate ypos;
 			size extents;
+			bool estimated = false;
 		};
 		typedef std::vector<glyph_line> glyph_lines;
 		class glyph_column : public column_info
@@ -387,6 +472,8 @@ namespace neogfx
 		typedef document_text::size_type position_type;
 	public:
 		struct bad_column_index : std::logic_error { bad_column_index() : std::logic_error("neogfx::text_edit::bad_column_index") {} }; 
+		struct failed_to_open_file : std::runtime_error { failed_to_open_file() : std::runtime_error("neogfx::text_edit::failed_to_open_file") {} };
+		struct no_syntax_highlighter : std::logic_error { no_syntax_highlighter() : std::logic_error("neogfx::text_edit::no_syntax_highlighter") {} };
 		// text_edit
 	public:
 		text_edit(type_e aType = MultiLine, frame_style aFrameStyle = frame_style::SolidFrame);
@@ -421,8 +508,10 @@ namespace neogfx
 		bool text_input(const std::string& aText) override;
 	public:
 		neogfx::scrolling_disposition scrolling_disposition() const override;
-		using scrollable_widget::update_scrollbar_visibility;
+		void update_scrollbar_visibility() override;
 		void update_scrollbar_visibility(usv_stage_e aStage) override;
+	public:
+		void scrollbar_updated(const i_scrollbar& aScrollbar, i_scrollbar::update_reason_e aReason) override;
 	public:
 		colour frame_colour() const override;
 		// i_clipboard
@@ -473,6 +562,10 @@ namespace neogfx
 		std::size_t insert_text(const std::string& aText, bool aMoveCursor = false);
 		std::size_t insert_text(const std::string& aText, const style& aStyle, bool aMoveCursor = false);
 		void delete_text(position_type aStart, position_type aEnd);
+		void load_text(const std::string& aFilePath);
+		void load_text(std::unique_ptr<std::istream> aStream);
+		bool loading_text() const;
+		void cancel_load_text();
 		std::size_t columns() const;
 		void set_columns(std::size_t aColumnCount);
 		void remove_columns();
@@ -484,6 +577,12 @@ namespace neogfx
 		dimension tab_stops() const;
 		void set_tab_stop_hint(const std::string& aTabStopHint = "0000");
 		void set_tab_stops(const optional_dimension& aTabStops);
+	public:
+		bool has_syntax_highlighter() const;
+		const i_syntax_highlighter& syntax_highlighter() const;
+		void set_syntax_highlighter(std::shared_ptr<i_syntax_highlighter> aHighlighter);
+		void clear_syntax_highlighter();
+		void rehighlight();
 	public:
 		position_type document_hit_test(const point& aPoint, bool aAdjustForScrollPosition = true) const;
 		virtual bool same_word(position_type aTextPositionLeft, position_type aTextPositionRight) const;
@@ -491,6 +590,14 @@ namespace neogfx
 	public:
 		neogfx::cursor& cursor() const;
 		void set_cursor_position(const point& aPoint, bool aMoveAnchor = true, bool aEnableDragger = false);
+	public:
+		bool find(const std::string& aPattern, const text_search_options& aOptions = text_search_options{});
+		bool find_next();
+		bool find_previous();
+		std::size_t replace_all(const std::string& aReplacement);
+		std::size_t find_match_count() const;
+		bool finding() const;
+		void clear_find();
 	private:
 		struct position_info
 		{
@@ -505,20 +612,67 @@ namespace neogfx
 		position_type cursor_glyph_position() const;
 		position_type cursor_glyph_anchor() const;
 		void set_cursor_glyph_position(position_type aGlyphPosition, bool aMoveAnchor = true);
+	private:
+		static constexpr std::size_t UndoDepth = 1000u;
+		static constexpr std::size_t UndoTextLimit = 16u * 1024u * 1024u;
+		static constexpr std::size_t UndoBatchThreshold = 64u;
+		typedef std::vector<std::pair<document_text::tag_type, std::u32string>> undo_text;
+		struct undo_operation
+		{
+			enum type_e
+			{
+				Insert,
+				Erase
+			} type;
+			position_type position;
+			undo_text text;
+		};
+		struct undo_entry
+		{
+			std::vector<undo_operation> operations;
+			position_type cursorPosition;
+			position_type cursorAnchor;
+		};
+		typedef std::deque<undo_entry> undo_stack;
+		undo_text undoable_text(position_type aStart, position_type aEnd) const;
+		static std::size_t undo_size(const undo_text& aText);
+		static std::size_t undo_size(const undo_entry& aEntry);
+		void record_undo(undo_operation&& aOperation);
+		void push_undo(undo_entry&& aEntry);
+		void trim_undo();
+		bool coalesce_undo(undo_operation& aOperation);
+		void apply_undo_operation(const undo_operation& aOperation, bool aReverse, bool aRefresh = true);
+		void clear_undo();
 	private:
 		void init();
 		std::size_t do_insert_text(const std::string& aText, const style& aStyle, bool aMoveCursor, bool aClearFirst);
+		std::size_t insert_rich_text(const std::string& aRichText, bool aClearFirst);
 		void delete_any_selection();
 		void notify_text_changed();
+		std::optional<neogfx::font> loaded_text_font() const;
+		void append_loaded_text(const std::u32string& aText, const std::optional<neogfx::font>& aShapingFont, const std::vector<glyph_text::container>& aShapedParagraphs);
+		static constexpr std::size_t SynchronousFindLimit = 1024u * 1024u;
+		void select_match(const text_search::match& aMatch);
+		void restart_find(bool aAllowBackground = true);
+		void update_find_matches(position_type aPosition, ptrdiff_t aDelta);
+		void found_matches(const text_search::match_list& aMatches, bool aFinished);
+		void text_loaded();
 		std::pair<position_type, position_type> related_glyphs(position_type aGlyphPosition) const;
 		bool same_paragraph(position_type aFirstGlyphPos, position_type aSecondGlyphPos) const;
 		glyph_paragraphs::const_iterator character_to_paragraph(position_type aCharacterPos) const;
 		glyph_paragraphs::const_iterator glyph_to_paragraph(position_type aGlyphPos) const;
 		document_glyphs::const_iterator to_glyph(document_text::const_iterator aWhere) const;
 		std::pair<document_text::size_type, document_text::size_type> from_glyph(document_glyphs::const_iterator aWhere) const;
-		void refresh_paragraph(document_text::const_iterator aWhere, ptrdiff_t aDelta);
+		static constexpr std::size_t ShapingBatchSize = 256u;
+		static constexpr std::size_t ParallelShapingThreshold = 16u * 1024u;
+		void refresh_paragraph(document_text::const_iterator aWhere, ptrdiff_t aDelta, bool aRefreshLines = true, const std::vector<glyph_text::container>* aShapedParagraphs = nullptr);
 		void refresh_columns();
-		void refresh_lines();
+		void refresh_lines(bool aAppended = false);
+		void refresh_loaded_lines();
+		void wrap_paragraph(glyph_paragraphs::iterator aParagraph, dimension aAvailableWidth);
+		void refresh_estimated_lines();
+		void invalidate_highlight(position_type aWhere, ptrdiff_t aDelta, position_type aStart, position_type aEnd);
+		void update_highlight(position_type aUpTo) const;
 		void animate();
 		void update_cursor();
 		void make_cursor_visible(bool aForcePreviewScroll = false);
@@ -536,12 +690,26 @@ namespace neogfx
 		mutable neogfx::cursor iCursor;
 		style_list iStyles;
 		std::u32string iNormalizedTextBuffer;
-		document_text iPreviousText;
 		document_text iText;
 		document_glyphs iGlyphs;
 		glyph_paragraphs iGlyphParagraphs;
 		glyph_columns iGlyphColumns;
 		size iTextExtents;
+		struct line_refresh_state
+		{
+			std::size_t paragraphs;
+			size clientExtents;
+			dimension availableWidth;
+			dimension availableHeight;
+			bool showVerticalScrollbar;
+			bool showHorizontalScrollbar;
+			uint32_t pass;
+			coordinate y;
+			dimension width;
+		};
+		std::optional<line_refresh_state> iLineRefreshState;
+		static constexpr uint32_t LoadedChunksPerRefresh = 16u;
+		uint32_t iLoadedChunksSinceRefresh;
 		uint64_t iCursorAnimationStartTime;
 		typedef std::pair<position_type, position_type> find_span;
 		typedef std::map<
@@ -553,6 +721,20 @@ namespace neogfx
 		mutable std::optional<find_in_paragraph_cache::iterator> iCharacterToParagraphCacheLastAccess;
 		mutable find_in_paragraph_cache iGlyphToParagraphCache;
 		mutable std::optional<find_in_paragraph_cache::iterator> iGlyphToParagraphCacheLastAccess;
+		std::u32string iFindPattern;
+		text_search_options iFindOptions;
+		std::unique_ptr<text_search> iSearch;
+		std::vector<find_span> iFindMatches;
+		struct find_edit
+		{
+			position_type start;
+			position_type end;
+			ptrdiff_t delta;
+		};
+		std::vector<find_edit> iFindEdits;
+		std::shared_ptr<text_finder> iTextFinder;
+		std::shared_ptr<i_syntax_highlighter> iSyntaxHighlighter;
+		mutable std::optional<std::pair<position_type, position_type>> iStaleHighlight;
 		std::string iHint;
 		mutable std::optional<std::pair<neogfx::font, size>> iHintedSize;
 		optional_dimension iTabStops;
@@ -564,6 +746,13 @@ namespace neogfx
 		uint32_t iSuppressTextChangedNotification;
 		uint32_t iWantedToNotfiyTextChanged;
 		bool iOutOfMemory;
+		bool iUpdatingScrollbarVisibility;
+		std::shared_ptr<text_loader> iTextLoader;
+		undo_stack iUndoStack;
+		undo_stack iRedoStack;
+		std::size_t iUndoTextSize;
+		bool iUndoGroupStarted;
+		bool iUndoRedoInProgress;
 	public:
 		define_property(property_category::other, bool, ReadOnly, false)
 		define_property(property_category::other, bool, WordWrap, iType == MultiLine)
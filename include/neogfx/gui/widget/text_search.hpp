@@ -0,0 +1,145 @@
+// text_search.hpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <iterator>
+#include <optional>
+#include <algorithm>
+#include <functional>
+
+namespace neogfx
+{
+	struct text_search_options
+	{
+		bool caseSensitive = true;
+		bool regex = false;
+	};
+
+	/* Finds non-overlapping matches of a pattern in UTF-32 text. Plain patterns are located with a SIMD first/last
+	   character filter (SSE2 where available) falling back to Horspool; regular expressions are matched a paragraph
+	   at a time. Text is consumed from any random access range in fixed size blocks so the searched document need not
+	   be contiguous. */
+	class text_search
+	{
+	public:
+		struct bad_pattern : std::runtime_error { bad_pattern() : std::runtime_error("neogfx::text_search::bad_pattern") {} };
+	public:
+		typedef std::size_t position_type;
+		typedef std::pair<position_type, position_type> match;
+		typedef std::vector<match> match_list;
+		static constexpr position_type npos = static_cast<position_type>(-1);
+	private:
+		static constexpr std::size_t BlockSize = 64 * 1024;
+		class regex_matcher;
+	public:
+		text_search(const std::u32string& aPattern, const text_search_options& aOptions = text_search_options{});
+		~text_search();
+	public:
+		const std::u32string& pattern() const;
+		const text_search_options& options() const;
+	public:
+		template <typename Iter>
+		void find_all(Iter aBegin, Iter aEnd, match_list& aMatches, position_type aBase = 0, const std::atomic<bool>* aCancelled = nullptr) const
+		{
+			for_each_match(aBegin, aEnd, aBase, [&aMatches](const match& aMatch) { aMatches.push_back(aMatch); return true; }, aCancelled);
+		}
+		template <typename Iter>
+		std::optional<match> find_first(Iter aBegin, Iter aEnd, position_type aBase = 0) const
+		{
+			std::optional<match> result;
+			for_each_match(aBegin, aEnd, aBase, [&result](const match& aMatch) { result = aMatch; return false; });
+			return result;
+		}
+		template <typename Iter>
+		std::optional<match> find_last(Iter aBegin, Iter aEnd, position_type aBase = 0) const
+		{
+			std::optional<match> result;
+			for_each_match(aBegin, aEnd, aBase, [&result](const match& aMatch) { result = aMatch; return true; });
+			return result;
+		}
+		// calls aCallback for each match in turn until it returns false
+		template <typename Iter, typename Callback>
+		void for_each_match(Iter aBegin, Iter aEnd, position_type aBase, Callback aCallback, const std::atomic<bool>* aCancelled = nullptr) const
+		{
+			if (iPattern.empty())
+				return;
+			auto const length = static_cast<position_type>(std::distance(aBegin, aEnd));
+			std::u32string block;
+			position_type next = 0;
+			for (position_type blockStart = 0; blockStart < length;)
+			{
+				if (aCancelled != nullptr && *aCancelled)
+					return;
+				auto blockEnd = std::min(length, blockStart + BlockSize);
+				if (iOptions.regex)
+				{
+					// regular expressions see whole paragraphs
+					auto paragraphEnd = std::find(aBegin + blockEnd, aEnd, U'\n');
+					blockEnd = (paragraphEnd != aEnd ? static_cast<position_type>(paragraphEnd - aBegin) + 1 : length);
+				}
+				else if (blockEnd != length)
+					blockEnd = std::min(length, blockEnd + iPattern.size() - 1);
+				block.assign(aBegin + blockStart, aBegin + blockEnd);
+				auto const startLimit = (iOptions.regex || blockEnd == length ? block.size() : BlockSize);
+				if (!search_block(block, std::max(next, blockStart) - blockStart, startLimit, [&](const match& aMatch)
+				{
+					next = blockStart + aMatch.second;
+					return aCallback(match{ aBase + blockStart + aMatch.first, aBase + blockStart + aMatch.second });
+				}))
+					return;
+				blockStart += (iOptions.regex ? block.size() : BlockSize);
+			}
+		}
+	private:
+		template <typename Callback>
+		bool search_block(std::u32string& aBlock, position_type aFrom, position_type aStartLimit, Callback aCallback) const
+		{
+			if (iOptions.regex)
+				return search_regex(aBlock, aFrom, aStartLimit, aCallback);
+			if (!iOptions.caseSensitive)
+				fold(aBlock);
+			for (auto pos = aFrom; pos < aStartLimit;)
+			{
+				match m;
+				if (!search(aBlock, pos, m) || m.first >= aStartLimit)
+					break;
+				if (!aCallback(m))
+					return false;
+				pos = std::max(m.second, m.first + 1);
+			}
+			return true;
+		}
+		bool search(const std::u32string& aBlock, position_type aFrom, match& aMatch) const;
+		bool search_regex(const std::u32string& aBlock, position_type aFrom, position_type aStartLimit, const std::function<bool(const match&)>& aCallback) const;
+		position_type search_plain(const char32_t* aText, position_type aLength, position_type aFrom) const;
+		static void fold(std::u32string& aText);
+	private:
+		std::u32string iPattern;
+		text_search_options iOptions;
+		std::array<position_type, 256> iShift;
+		std::unique_ptr<const regex_matcher> iRegex;
+	};
+}
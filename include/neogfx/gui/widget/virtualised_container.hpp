@@ -0,0 +1,84 @@
+// virtualised_container.hpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+#include <functional>
+#include "scrollable_widget.hpp"
+
+namespace neogfx
+{
+	// A vertically scrolling container that only instantiates child widgets for the items in view (plus an
+	// overscan margin); widgets scrolled out of view are recycled for the items scrolled into view. Unseen
+	// items are assumed to have the average extent of the items measured so far.
+	class virtualised_container : public scrollable_widget
+	{
+	public:
+		typedef uint32_t item_index;
+		// aRecycled is a widget that has scrolled out of view (or null); the factory can rebind and return it or
+		// return a new widget for aIndex.
+		typedef std::function<std::shared_ptr<i_widget>(item_index aIndex, std::shared_ptr<i_widget> aRecycled)> widget_factory;
+	private:
+		typedef std::pair<item_index, std::shared_ptr<i_widget>> live_item;
+		typedef std::vector<live_item> live_list;
+		typedef std::vector<std::shared_ptr<i_widget>> widget_pool;
+	public:
+		struct no_widget : std::logic_error { no_widget() : std::logic_error("neogfx::virtualised_container::no_widget") {} };
+	public:
+		static const uint32_t DefaultOverscan = 4u;
+	public:
+		virtualised_container(widget_factory aFactory, scrollbar_style aScrollbarStyle = scrollbar_style::Normal, frame_style aFrameStyle = frame_style::SolidFrame);
+		virtualised_container(i_widget& aParent, widget_factory aFactory, scrollbar_style aScrollbarStyle = scrollbar_style::Normal, frame_style aFrameStyle = frame_style::SolidFrame);
+		virtualised_container(i_layout& aLayout, widget_factory aFactory, scrollbar_style aScrollbarStyle = scrollbar_style::Normal, frame_style aFrameStyle = frame_style::SolidFrame);
+		~virtualised_container();
+	public:
+		item_index item_count() const;
+		void set_item_count(item_index aItemCount);
+		void items_changed();
+		uint32_t overscan() const;
+		void set_overscan(uint32_t aOverscan);
+		dimension estimated_item_extent() const;
+		void set_estimated_item_extent(dimension aExtent);
+		std::size_t widget_count() const;
+		void make_visible(item_index aIndex);
+	protected:
+		neogfx::scrolling_disposition scrolling_disposition() const override;
+		neogfx::scrolling_disposition scrolling_disposition(const i_widget& aChildWidget) const override;
+		void scrollbar_updated(const i_scrollbar& aScrollbar, i_scrollbar::update_reason_e aReason) override;
+		void update_scrollbar_visibility() override;
+		void update_scrollbar_visibility(usv_stage_e aStage) override;
+	private:
+		void realise();
+		std::shared_ptr<i_widget> acquire(item_index aIndex, live_list& aPrevious, bool& aMeasure);
+		void recycle(std::shared_ptr<i_widget> aWidget);
+		void recycle_all();
+		dimension total_extent() const;
+	private:
+		widget_factory iFactory;
+		item_index iItemCount;
+		uint32_t iOverscan;
+		dimension iEstimatedExtent;
+		dimension iMeasuredTotal;
+		uint64_t iMeasuredCount;
+		live_list iLive;
+		widget_pool iPool;
+		bool iRealising;
+	};
+}
@@ -131,6 +131,7 @@ namespace neogfx
 		void moved() override;
 		void resize(const size& aSize) override;
 		void resized() override;
+		void child_geometry_changed(const i_widget& aChild) override;
 		const i_widget& get_widget_at(const point& aPosition) const override;
 		i_widget& get_widget_at(const point& aPosition) override;
 		widget_part hit_test(const point& aPosition) const override;
@@ -163,9 +164,12 @@ namespace neogfx
 		bool ready_to_render() const override;
 		void render(graphics_context& aGraphicsContext) const override;
 		bool transparent_background() const override;
+		bool opaque() const override;
 		void paint_non_client(graphics_context& aGraphicsContext) const override;
 		void paint(graphics_context& aGraphicsContext) const override;
 		void paint_non_client_after(graphics_context& aGraphicsContext) const override;
+	public:
+		static uint64_t culled_widget_total();
 	public:
 		double opacity() const override;
 		void set_opacity(double aOpacity) override;
@@ -239,6 +243,9 @@ namespace neogfx
 		using i_widget::hide;
 		using i_widget::enable;
 		using i_widget::disable;
+	private:
+		class spatial_index;
+		const spatial_index* child_spatial_index() const;
 		// state
 	private:
 		bool iSingular;
@@ -251,10 +258,9 @@ namespace neogfx
 		i_layout* iParentLayout;
 		uint32_t iLayoutInProgress;
 		std::shared_ptr<i_layout> iLayout;
-		class layout_timer;
-		std::unique_ptr<layout_timer> iLayoutTimer;
 		units_context iUnitsContext;
 		mutable std::pair<optional_rect, optional_rect> iDefaultClipRect;
+		mutable std::unique_ptr<spatial_index> iSpatialIndex;
 		// properties
 	public:
 		struct property_category
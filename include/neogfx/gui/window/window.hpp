@@ -126,6 +126,7 @@ namespace neogfx
 		bool update(const rect& aUpdateRect) override;
 		void render(graphics_context& aGraphicsContext) const override;
 		void paint(graphics_context& aGraphicsContext) const override;
+		uint32_t culled_widget_count() const;
 	public:
 		colour background_colour() const override;
 	public:
@@ -213,6 +214,7 @@ namespace neogfx
 		std::unique_ptr<i_surface_window> iSurfaceWindow;
 		std::unique_ptr<i_nested_window> iNestedWindowDetails;
 		std::string iTitleText;
+		mutable uint32_t iCulledWidgetCount;
 		window_style iStyle;
 		int32_t iCountedEnable;
 		i_widget* iEnteredWidget;
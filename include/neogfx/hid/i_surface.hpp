@@ -85,6 +85,7 @@ namespace neogfx
 		virtual void set_logical_coordinates(const std::pair<vec2, vec2>& aCoordinates) = 0;
 		virtual void layout_surface() = 0;
 		virtual void invalidate_surface(const rect& aInvalidatedRect, bool aInternal = true) = 0;
+		virtual bool scroll_surface(const rect& aScrolledArea, const point& aDelta) = 0;
 		virtual bool has_invalidated_area() const = 0;
 		virtual const rect& invalidated_area() const = 0;
 		virtual rect validate() = 0;
@@ -62,6 +62,7 @@ namespace neogfx
 		void set_logical_coordinates(const std::pair<vec2, vec2>& aCoordinates) override;
 		void layout_surface() override;
 		void invalidate_surface(const rect& aInvalidatedRect, bool aInternal = true) override;
+		bool scroll_surface(const rect& aScrolledArea, const point& aDelta) override;
 		bool has_invalidated_area() const override;
 		const rect& invalidated_area() const override;
 		rect validate() override;
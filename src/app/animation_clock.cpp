@@ -0,0 +1,140 @@
+// animation_clock.cpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+#include <neolib/raii.hpp>
+#include <neogfx/app/animation_clock.hpp>
+
+namespace neogfx
+{
+	animation_clock* animation_clock::sInstance;
+
+	animation_clock::animation_clock(neolib::async_task& aIoTask, uint32_t aInterval) :
+		iInterval{ aInterval },
+		iTimer{ aIoTask, [this](neolib::callback_timer&) { tick(); }, aInterval, false },
+		iNextCookie{ 0u },
+		iTicks{ 0u },
+		iTicking{ false }
+	{
+		if (sInstance != nullptr)
+			throw instance_exists();
+		sInstance = this;
+	}
+
+	animation_clock::~animation_clock()
+	{
+		if (iTimer.waiting())
+			iTimer.cancel();
+		sInstance = nullptr;
+	}
+
+	bool animation_clock::has_instance()
+	{
+		return sInstance != nullptr;
+	}
+
+	animation_clock& animation_clock::instance()
+	{
+		if (sInstance != nullptr)
+			return *sInstance;
+		throw no_instance();
+	}
+
+	uint32_t animation_clock::interval() const
+	{
+		return iInterval;
+	}
+
+	uint64_t animation_clock::ticks() const
+	{
+		return iTicks;
+	}
+
+	std::size_t animation_clock::subscriber_count() const
+	{
+		return iSubscribers.size();
+	}
+
+	animation_clock::cookie animation_clock::subscribe(callback aCallback)
+	{
+		auto newCookie = iNextCookie++;
+		iSubscribers.emplace(newCookie, aCallback);
+		if (!iTicking)
+			iTimer.again_if();
+		return newCookie;
+	}
+
+	void animation_clock::unsubscribe(cookie aCookie)
+	{
+		iSubscribers.erase(aCookie);
+		if (iSubscribers.empty() && !iTicking && iTimer.waiting())
+			iTimer.cancel();
+	}
+
+	void animation_clock::tick()
+	{
+		// an animation may process events (and so re-enter the clock), subscribe or unsubscribe
+		// animations, or destroy its owner while it is being advanced
+		if (iTicking)
+			return;
+		neolib::scoped_flag sf{ iTicking };
+		++iTicks;
+		auto const lastCookie = iNextCookie;
+		for (auto next = iSubscribers.begin(); next != iSubscribers.end() && next->first < lastCookie;)
+		{
+			auto const current = next->first;
+			auto animator = next->second;
+			animator();
+			next = iSubscribers.upper_bound(current);
+		}
+		if (!iSubscribers.empty())
+			iTimer.again();
+	}
+
+	animation::animation(animation_clock::callback aCallback) :
+		iCallback{ aCallback }
+	{
+	}
+
+	animation::~animation()
+	{
+		stop();
+	}
+
+	bool animation::running() const
+	{
+		return iCookie != std::nullopt;
+	}
+
+	void animation::start()
+	{
+		if (!running())
+			iCookie = animation_clock::instance().subscribe(iCallback);
+	}
+
+	void animation::stop()
+	{
+		if (running())
+		{
+			if (animation_clock::has_instance())
+				animation_clock::instance().unsubscribe(*iCookie);
+			iCookie = std::nullopt;
+		}
+	}
+}
@@ -193,6 +193,7 @@ namespace neogfx
 		iActionPaste{ add_action("Paste"_t, ":/neogfx/resources/icons.naa#paste.png").set_shortcut("Ctrl+V") },
 		iActionDelete{ add_action("Delete"_t).set_shortcut("Del") },
 		iActionSelectAll{ add_action("Select All"_t).set_shortcut("Ctrl+A") },
+		iAnimationClock{ *this },
 		iStandardActionManager{ *this, [this](neolib::callback_timer& aTimer)
 		{
 			aTimer.again();
@@ -70,6 +70,16 @@ namespace neogfx
 		iSystemClipboard.set_text(aText);
 	}
 
+	bool clipboard::has_html() const
+	{
+		return iSystemClipboard.has_html();
+	}
+
+	std::string clipboard::html() const
+	{
+		return iSystemClipboard.html();
+	}
+
 	void clipboard::cut()
 	{
 		if (sink_active())
@@ -29,5 +29,7 @@ namespace neogfx
 		virtual bool has_text() const = 0;
 		virtual std::string text() const = 0;
 		virtual void set_text(const std::string& aText) = 0;
+		virtual bool has_html() const = 0;
+		virtual std::string html() const = 0;
 	};
 }
\ No newline at end of file
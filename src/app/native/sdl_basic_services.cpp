@@ -248,6 +248,54 @@ namespace neogfx
 		{
 			SDL_SetClipboardText(aText.c_str());
 		}
+		bool has_html() const override
+		{
+#ifdef WIN32
+			return ::IsClipboardFormatAvailable(html_format()) != FALSE;
+#else
+			return false;
+#endif
+		}
+		std::string html() const override
+		{
+			std::string result;
+#ifdef WIN32
+			// CF_HTML is UTF-8 with a header giving the byte offsets of the copied fragment
+			if (::OpenClipboard(NULL) == FALSE)
+				return result;
+			HANDLE data = ::GetClipboardData(html_format());
+			if (data != NULL)
+			{
+				auto buffer = static_cast<const char*>(::GlobalLock(data));
+				if (buffer != nullptr)
+				{
+					std::string const clip{ buffer, ::strnlen(buffer, ::GlobalSize(data)) };
+					::GlobalUnlock(data);
+					auto offset = [&clip](const std::string& aKey) -> std::string::size_type
+					{
+						auto pos = clip.find(aKey);
+						if (pos == std::string::npos)
+							return std::string::npos;
+						return std::strtoul(clip.c_str() + pos + aKey.size(), nullptr, 10);
+					};
+					auto start = offset("StartFragment:");
+					auto end = offset("EndFragment:");
+					if (start != std::string::npos && end != std::string::npos && start <= end && end <= clip.size())
+						result = clip.substr(start, end - start);
+				}
+			}
+			::CloseClipboard();
+#endif
+			return result;
+		}
+	private:
+#ifdef WIN32
+		static UINT html_format()
+		{
+			static const UINT sHtmlFormat = ::RegisterClipboardFormatA("HTML Format");
+			return sHtmlFormat;
+		}
+#endif
 	};
 
 	bool sdl_basic_services::has_system_clipboard() const
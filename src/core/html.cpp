@@ -19,7 +19,9 @@
 
 #include <neogfx/neogfx.hpp>
 #include <string>
-#include <neolib/lexer.hpp>
+#include <algorithm>
+#include <cctype>
+#include <neolib/string_utils.hpp>
 #include <neogfx/core/html.hpp>
 
 using namespace std::string_literals;
@@ -28,61 +30,331 @@ namespace neogfx
 {
 	namespace
 	{
-		enum class token
+		class null_visitor : public html::i_visitor
 		{
-			OpenTag,
-			CloseTag,
-			Comment,
-			Whitespace
-		};
+		public:
+			void start_element(const std::string&, const html::attribute_list&, bool) override {}
+			void end_element(const std::string&) override {}
+			void text(const std::string&) override {}
+		} sNullVisitor;
 
-		enum class scope
+		const std::pair<const char*, char32_t> sEntities[] =
 		{
-			Document,
-			ElementTag,
-			ElementContents
+			{ "amp", U'&' },
+			{ "lt", U'<' },
+			{ "gt", U'>' },
+			{ "quot", U'"' },
+			{ "apos", U'\'' },
+			{ "nbsp", U'\x00A0' },
+			{ "copy", U'\x00A9' },
+			{ "reg", U'\x00AE' },
+			{ "trade", U'\x2122' },
+			{ "hellip", U'\x2026' },
+			{ "ndash", U'\x2013' },
+			{ "mdash", U'\x2014' },
+			{ "lsquo", U'\x2018' },
+			{ "rsquo", U'\x2019' },
+			{ "ldquo", U'\x201C' },
+			{ "rdquo", U'\x201D' },
+			{ "bull", U'\x2022' },
+			{ "middot", U'\x00B7' },
+			{ "euro", U'\x20AC' },
+			{ "pound", U'\x00A3' },
+			{ "deg", U'\x00B0' }
 		};
 
-		typedef neolib::lexer_token<token> lexer_token;
-		typedef neolib::lexer_atom<token, scope> lexer_atom;
-		typedef neolib::lexer_rule<lexer_atom> lexer_rule;
-		const lexer_rule sLexerRules[] =
+		bool is_space(char aChar)
 		{
-			{ token::OpenTag, {{ '<' }} },
-			{ token::CloseTag, {{ '>' }} },
-			{ lexer_rule::enter_scope(scope::ElementTag), {{ scope::Document, token::OpenTag }} },
-			{ lexer_rule::leave_scope(scope::ElementTag), {{ scope::Document, token::CloseTag }} },
-		};
+			return aChar == ' ' || aChar == '\t' || aChar == '\r' || aChar == '\n' || aChar == '\f';
+		}
+
+		void to_lower(std::string& aText)
+		{
+			for (auto& ch : aText)
+				if (ch >= 'A' && ch <= 'Z')
+					ch = static_cast<char>(ch - 'A' + 'a');
+		}
 	}
 
-	html::html(const std::string& aStyle) :
-		iDocument{std::make_shared<std::istringstream>(aStyle)}
+	html::html(const std::string& aFragment) :
+		html{ aFragment, sNullVisitor }
 	{
-		parse();
 	}
 
 	html::html(std::istream& aDocument) :
-		iDocument{ std::shared_ptr<std::istream>{ std::shared_ptr<std::istream>{}, &aDocument } }
+		html{ aDocument, sNullVisitor }
+	{
+	}
+
+	html::html(const std::string& aFragment, i_visitor& aVisitor) :
+		iVisitor{ &aVisitor }, iState{ state::Text }, iQuote{ 0 }, iDashes{ 0u }
+	{
+		parse(aFragment.data(), aFragment.data() + aFragment.size());
+		finish();
+	}
+
+	html::html(std::istream& aDocument, i_visitor& aVisitor) :
+		iVisitor{ &aVisitor }, iState{ state::Text }, iQuote{ 0 }, iDashes{ 0u }
 	{
-		parse();
+		parse(aDocument);
+		finish();
+	}
+
+	std::string html::escape(const std::string& aText)
+	{
+		std::string result;
+		result.reserve(aText.size());
+		for (auto ch : aText)
+		{
+			switch (ch)
+			{
+			case '&':
+				result += "&amp;";
+				break;
+			case '<':
+				result += "&lt;";
+				break;
+			case '>':
+				result += "&gt;";
+				break;
+			case '"':
+				result += "&quot;";
+				break;
+			default:
+				result += ch;
+				break;
+			}
+		}
+		return result;
 	}
 
-	void html::parse()
+	void html::parse(std::istream& aDocument)
 	{
-		static const neolib::lexer<lexer_atom> sLexer{ scope::Document, std::cbegin(sLexerRules), std::cend(sLexerRules) };
-		neolib::lexer<lexer_atom>::context lexerContext = sLexer.use(*iDocument);
-		if (!lexerContext)
+		if (!aDocument)
 			throw failed_to_open_html();
-		std::vector<lexer_token> tokens;
-		lexer_token token;
-		while (lexerContext >> token)
-			tokens.push_back(token);
-		tokens.erase(
-			std::remove_if(tokens.begin(), tokens.end(), 
-				[](const lexer_token& aToken) 
-				{ 
-					return aToken.first == token::Whitespace || aToken.first == token::Comment; 
-				}), 
-			tokens.end());
+		char buffer[64 * 1024];
+		while (aDocument)
+		{
+			aDocument.read(buffer, sizeof(buffer));
+			auto const count = static_cast<std::size_t>(aDocument.gcount());
+			if (count == 0)
+				break;
+			parse(buffer, buffer + count);
+		}
+	}
+
+	void html::parse(const char* aBegin, const char* aEnd)
+	{
+		for (auto next = aBegin; next != aEnd; ++next)
+		{
+			char const ch = *next;
+			switch (iState)
+			{
+			case state::Text:
+				if (ch == '<')
+				{
+					iState = state::Tag;
+					iTag.clear();
+					iQuote = 0;
+				}
+				else
+					iText += ch;
+				break;
+			case state::Tag:
+				if (iTag.empty() && !std::isalpha(static_cast<unsigned char>(ch)) && ch != '/' && ch != '!' && ch != '?')
+				{
+					// not a tag after all
+					iText += '<';
+					iText += ch;
+					iState = state::Text;
+				}
+				else if (iQuote != 0)
+				{
+					if (ch == iQuote)
+						iQuote = 0;
+					iTag += ch;
+				}
+				else if (ch == '>')
+				{
+					process_tag();
+					if (iState == state::Tag)
+						iState = state::Text;
+				}
+				else
+				{
+					if ((ch == '"' || ch == '\'') && !iTag.empty() && iTag.back() == '=')
+						iQuote = ch;
+					iTag += ch;
+					if (iTag == "!--")
+					{
+						iState = state::Comment;
+						iDashes = 0u;
+					}
+				}
+				break;
+			case state::Comment:
+				if (ch == '>' && iDashes >= 2u)
+					iState = state::Text;
+				iDashes = (ch == '-' ? iDashes + 1u : 0u);
+				break;
+			case state::RawText:
+				iText += ch;
+				if (iText.size() >= iRawTextEnd.size() && std::equal(iRawTextEnd.begin(), iRawTextEnd.end(), iText.end() - iRawTextEnd.size(),
+					[](char aLhs, char aRhs) { return aLhs == std::tolower(static_cast<unsigned char>(aRhs)); }))
+				{
+					iText.erase(iText.size() - iRawTextEnd.size());
+					if (!iText.empty())
+						iVisitor->text(iText);
+					iText.clear();
+					iTag.assign(iRawTextEnd, 1, std::string::npos);
+					iQuote = 0;
+					iState = state::Tag;
+				}
+				break;
+			}
+		}
+	}
+
+	void html::finish()
+	{
+		if (iState == state::Tag)
+		{
+			iText += '<';
+			iText += iTag;
+		}
+		iState = state::Text;
+		flush_text();
+	}
+
+	void html::flush_text()
+	{
+		if (iText.empty())
+			return;
+		decode(iText);
+		iVisitor->text(iText);
+		iText.clear();
+	}
+
+	void html::process_tag()
+	{
+		flush_text();
+		if (iTag.empty() || iTag[0] == '!' || iTag[0] == '?')
+			return;
+		bool const endTag = (iTag[0] == '/');
+		auto next = iTag.begin() + (endTag ? 1 : 0);
+		auto const end = iTag.end();
+		auto const nameStart = next;
+		while (next != end && !is_space(*next) && *next != '/')
+			++next;
+		iName.assign(nameStart, next);
+		to_lower(iName);
+		if (iName.empty())
+			return;
+		if (endTag)
+		{
+			iVisitor->end_element(iName);
+			return;
+		}
+		iAttributes.clear();
+		bool empty = false;
+		while (next != end)
+		{
+			if (is_space(*next))
+			{
+				++next;
+				continue;
+			}
+			if (*next == '/')
+			{
+				empty = (std::next(next) == end);
+				++next;
+				continue;
+			}
+			auto const attributeNameStart = next;
+			while (next != end && !is_space(*next) && *next != '=' && *next != '/')
+				++next;
+			iAttributes.emplace_back(std::string{ attributeNameStart, next }, std::string{});
+			to_lower(iAttributes.back().first);
+			while (next != end && is_space(*next))
+				++next;
+			if (next == end || *next != '=')
+				continue;
+			++next;
+			while (next != end && is_space(*next))
+				++next;
+			if (next != end && (*next == '"' || *next == '\''))
+			{
+				auto const quote = *next++;
+				auto const valueStart = next;
+				while (next != end && *next != quote)
+					++next;
+				iAttributes.back().second.assign(valueStart, next);
+				if (next != end)
+					++next;
+			}
+			else
+			{
+				auto const valueStart = next;
+				while (next != end && !is_space(*next))
+					++next;
+				iAttributes.back().second.assign(valueStart, next);
+			}
+			decode(iAttributes.back().second);
+		}
+		iVisitor->start_element(iName, iAttributes, empty);
+		if (!empty && (iName == "script" || iName == "style"))
+		{
+			iRawTextEnd = "</"s + iName;
+			iState = state::RawText;
+		}
+	}
+
+	void html::decode(std::string& aText)
+	{
+		auto const ampersand = aText.find('&');
+		if (ampersand == std::string::npos)
+			return;
+		std::string result{ aText, 0, ampersand };
+		for (auto next = aText.begin() + ampersand; next != aText.end();)
+		{
+			if (*next != '&')
+			{
+				result += *next++;
+				continue;
+			}
+			auto const limit = (aText.end() - next > 12 ? next + 12 : aText.end());
+			auto const semicolon = std::find(next, limit, ';');
+			char32_t decoded = 0;
+			if (semicolon != limit && semicolon - next > 1)
+			{
+				std::string const name{ next + 1, semicolon };
+				if (name[0] == '#')
+				{
+					bool const hex = (name.size() > 1 && (name[1] == 'x' || name[1] == 'X'));
+					try
+					{
+						decoded = static_cast<char32_t>(std::stoul(name.substr(hex ? 2 : 1), nullptr, hex ? 16 : 10));
+					}
+					catch (...)
+					{
+						decoded = 0;
+					}
+				}
+				else
+				{
+					for (const auto& entity : sEntities)
+						if (name == entity.first)
+							decoded = entity.second;
+				}
+			}
+			if (decoded != 0 && decoded <= 0x10FFFF)
+			{
+				result += neolib::utf32_to_utf8(std::u32string(1, decoded));
+				next = semicolon + 1;
+			}
+			else
+				result += *next++;
+		}
+		aText = std::move(result);
 	}
 }
@@ -18,6 +18,7 @@
 */
 
 #include <neogfx/neogfx.hpp>
+#include <list>
 #include <neolib/string_utils.hpp>
 #include <neogfx/gfx/graphics_context.hpp>
 #ifdef u8
@@ -380,13 +381,12 @@ namespace neogfx
 
 	size graphics_context::text_extent(string::const_iterator aTextBegin, string::const_iterator aTextEnd, const font& aFont, const glyph_text_cache_usage& aCacheUsage) const
 	{
-		const auto& glyphText = aCacheUsage.use && !iGlyphTextCache->empty() ? *iGlyphTextCache : to_glyph_text(aTextBegin, aTextEnd, aFont);
-		if (aCacheUsage.use && iGlyphTextCache->empty())
+		if (!aCacheUsage.use)
+			return from_device_units(device_text_metrics(aTextBegin, aTextEnd, aFont, false, 0.0).extents);
+		const auto& glyphText = !iGlyphTextCache->empty() ? *iGlyphTextCache : to_glyph_text(aTextBegin, aTextEnd, aFont);
+		if (iGlyphTextCache->empty())
 			*iGlyphTextCache = glyphText;
-		auto result = glyphText.extents();
-		if (result.cy == 0.0)
-			result.cy = aFont.height();
-		return from_device_units(result);
+		return from_device_units(compute_text_metrics(glyphText, aFont, false, 0.0).extents);
 	}
 
 	size graphics_context::multiline_text_extent(const string& aText, const font& aFont, const glyph_text_cache_usage& aCacheUsage) const
@@ -396,78 +396,23 @@ namespace neogfx
 
 	size graphics_context::multiline_text_extent(const string& aText, const font& aFont, dimension aMaxWidth, const glyph_text_cache_usage& aCacheUsage) const
 	{
-		const auto& glyphText = aCacheUsage.use && !iGlyphTextCache->empty() ? *iGlyphTextCache : to_glyph_text(aText.begin(), aText.end(), aFont);
-		if (aCacheUsage.use && iGlyphTextCache->empty())
+		auto const maxWidth = to_device_units(size(aMaxWidth, 0)).cx;
+		if (!aCacheUsage.use)
+			return from_device_units(device_text_metrics(aText.begin(), aText.end(), aFont, true, maxWidth).extents);
+		const auto& glyphText = !iGlyphTextCache->empty() ? *iGlyphTextCache : to_glyph_text(aText.begin(), aText.end(), aFont);
+		if (iGlyphTextCache->empty())
 			*iGlyphTextCache = glyphText;
-		typedef std::pair<glyph_text::const_iterator, glyph_text::const_iterator> line_t;
-		typedef std::vector<line_t> lines_t;
-		lines_t lines;
-		std::array<glyph, 2> delimeters = { glyph{ text_category::Whitespace, '\r' }, glyph{ text_category::Whitespace, '\n' } };
-		neolib::tokens(glyphText.cbegin(), glyphText.cend(), delimeters.begin(), delimeters.end(), lines, 0, false);
-		size result;
-		for (lines_t::const_iterator i = lines.begin(); i != lines.end(); ++i)
-		{
-			if (aMaxWidth == 0)
-			{
-				size lineExtent = from_device_units(glyph_text::extents(i->first, i->second));
-				result.cx = std::max(result.cx, lineExtent.cx);
-				result.cy += lineExtent.cy;
-			}
-			else if (i->first != i->second)
-			{
-				glyph_text::const_iterator next = i->first;
-				glyph_text::const_iterator lineStart = next;
-				glyph_text::const_iterator lineEnd = i->second;
-				dimension maxWidth = to_device_units(size(aMaxWidth, 0)).cx;
-				dimension lineWidth = 0;
-				bool gotLine = false;
-				while (next != i->second)
-				{
-					if (lineWidth + next->extents().cx > maxWidth)
-					{
-						if (next != lineStart)
-						{
-							std::pair<glyph_text::const_iterator, glyph_text::const_iterator> wordBreak = glyphText.word_break(lineStart, next);
-							lineWidth -= glyph_text::extents(wordBreak.first, next, false).cx;
-							lineEnd = wordBreak.first;
-							next = wordBreak.second;
-							if (lineEnd == next)
-							{
-								while (lineEnd != i->second && (lineEnd + 1)->source() == wordBreak.first->source())
-									++lineEnd;
-								next = lineEnd;
-							}
-						}
-						else
-						{
-							lineWidth += next->advance().cx;
-							++next;
-						}
-						gotLine = true;
-					}
-					else
-					{
-						lineWidth += next->advance().cx;
-						++next;
-					}
-					if (gotLine || next == i->second)
-					{
-						lineWidth += (std::prev(next)->extents().cx - std::prev(next)->advance().cx);
-						result.cx = std::max(result.cx, from_device_units(size(lineWidth, 0)).cx);
-						result.cy += from_device_units(glyph_text::extents(i->first, i->second)).cy;
-						lineStart = next;
-						lineEnd = i->second;
-						lineWidth = 0;
-						gotLine = false;
-					}
-				}
-			}
-			else
-				result.cy += aFont.height();
-		}
-		if (result.cy == 0)
-			result.cy = from_device_units(size{ 0.0, aFont.height() }).cy;
-		return result;
+		return from_device_units(compute_text_metrics(glyphText, aFont, true, maxWidth).extents);
+	}
+
+	text_metrics graphics_context::measure_text(const string& aText, const font& aFont) const
+	{
+		return from_device_units(device_text_metrics(aText.begin(), aText.end(), aFont, false, 0.0));
+	}
+
+	text_metrics graphics_context::measure_multiline_text(const string& aText, const font& aFont, dimension aMaxWidth) const
+	{
+		return from_device_units(device_text_metrics(aText.begin(), aText.end(), aFont, true, to_device_units(size(aMaxWidth, 0)).cx));
 	}
 
 	bool graphics_context::is_text_left_to_right(const string& aText, const font& aFont, const glyph_text_cache_usage& aCacheUsage) const
@@ -845,6 +790,40 @@ namespace neogfx
 		return to_glyph_text_impl(aTextBegin, aTextEnd, aFontSelector);
 	}
 
+	bool graphics_context::shape_text(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, std::function<font(std::u32string::size_type)> aFontSelector, glyph_text::container& aResult) const
+	{
+		aResult = to_glyph_text_impl(aTextBegin, aTextEnd, aFontSelector, false);
+		return !aResult.empty() || aTextBegin == aTextEnd;
+	}
+
+	void graphics_context::finish_shaping(glyph& aGlyph) const
+	{
+		if (aGlyph.category() == text_category::Whitespace || aGlyph.category() == text_category::Emoji)
+			return;
+		dimension visibleExtent = 0.0;
+		try
+		{
+			const i_glyph_texture& glyphTexture = aGlyph.glyph_texture();
+			visibleExtent = aGlyph.offset().cx + glyphTexture.placement().x + glyphTexture.texture().extents().cx;
+			aGlyph.set_visible_extent(static_cast<float>(visibleExtent));
+		}
+		catch (...)
+		{
+			// silently ignore freetype exceptions; the advance stands in for the visible extent.
+			return;
+		}
+		auto advance = aGlyph.advance(false);
+		if (aGlyph.advance() != advance.ceil())
+		{
+			auto visibleAdvance = std::ceil(visibleExtent);
+			if (visibleAdvance > advance.cx)
+			{
+				advance.cx = visibleAdvance;
+				aGlyph.set_advance(advance);
+			}
+		}
+	}
+
 	void graphics_context::draw_glyph(const point& aPoint, const glyph& aGlyph, const text_appearance& aAppearance) const
 	{
 		draw_glyph(aPoint.to_vec3(), aGlyph, aAppearance);
@@ -990,6 +969,39 @@ namespace neogfx
 		native_context().enqueue(graphics_operation::draw_textures{mesh,	aColour, aShaderEffect});	
 	}
 
+	namespace
+	{
+		// each glyph run is shaped into a HarfBuzz buffer of its own taken from a per-thread pool so text can be shaped on more
+		// than one thread at a time
+		class harfbuzz_buffers
+		{
+		public:
+			~harfbuzz_buffers()
+			{
+				for (auto buffer : iBuffers)
+					hb_buffer_destroy(buffer);
+			}
+		public:
+			hb_buffer_t* acquire()
+			{
+				if (iBuffers.empty())
+					return hb_buffer_create();
+				auto buffer = iBuffers.back();
+				iBuffers.pop_back();
+				return buffer;
+			}
+			void release(hb_buffer_t* aBuffer)
+			{
+				hb_buffer_clear_contents(aBuffer);
+				iBuffers.push_back(aBuffer);
+			}
+		private:
+			std::vector<hb_buffer_t*> iBuffers;
+		};
+
+		thread_local harfbuzz_buffers tHarfBuzzBuffers;
+	}
+
 	class graphics_context::glyph_shapes
 	{
 	public:
@@ -1000,14 +1012,12 @@ namespace neogfx
 		public:
 			glyphs(const graphics_context& aParent, const font& aFont, const glyph_text_data::glyph_run& aGlyphRun) :
 				iParent{ aParent },
-				iFont{ static_cast<native_font_face::hb_handle*>(aFont.native_font_face().aux_handle())->font },
 				iGlyphRun{ aGlyphRun },
-				iBuf{ static_cast<native_font_face::hb_handle*>(aFont.native_font_face().aux_handle())->buf },
+				iBuf{ tHarfBuzzBuffers.acquire() },
 				iGlyphCount{ 0u },
 				iGlyphInfo{ nullptr },
 				iGlyphPos{ nullptr }
 			{
-				hb_ft_font_set_load_flags(iFont, aParent.is_subpixel_rendering_on() ? FT_LOAD_TARGET_LCD : FT_LOAD_TARGET_NORMAL);
 				hb_buffer_set_direction(iBuf, std::get<2>(aGlyphRun) == text_direction::RTL ? HB_DIRECTION_RTL : HB_DIRECTION_LTR);
 				hb_buffer_set_script(iBuf, std::get<4>(aGlyphRun));
 				std::vector<uint32_t> reversed;
@@ -1044,7 +1054,14 @@ namespace neogfx
 					}
 					hb_buffer_add_utf32(iBuf, &*reversed.begin(), reversed.size(), 0, reversed.size());
 				}
-				hb_shape(iFont, iBuf, NULL, 0);
+				{
+					// the HarfBuzz font calls into FreeType so it is used under the face's FreeType lock
+					auto const& fontFace = static_cast<const native_font_face&>(aFont.native_font_face());
+					std::lock_guard<std::recursive_mutex> lock{ fontFace.freetype_mutex() };
+					auto hbFont = static_cast<native_font_face::hb_handle*>(fontFace.aux_handle())->font;
+					hb_ft_font_set_load_flags(hbFont, aParent.is_subpixel_rendering_on() ? FT_LOAD_TARGET_LCD : FT_LOAD_TARGET_NORMAL);
+					hb_shape(hbFont, iBuf, NULL, 0);
+				}
 				unsigned int glyphCount = 0;
 				iGlyphInfo = hb_buffer_get_glyph_infos(iBuf, &glyphCount);
 				iGlyphPos = hb_buffer_get_glyph_positions(iBuf, &glyphCount);
@@ -1053,9 +1070,10 @@ namespace neogfx
 					for (uint32_t i = 0; i < iGlyphCount; ++i)
 						iGlyphInfo[i].cluster = std::get<1>(aGlyphRun) - std::get<0>(aGlyphRun) - 1 - iGlyphInfo[i].cluster;
 			}
+			glyphs(const glyphs&) = delete;
 			~glyphs()
 			{
-				hb_buffer_clear_contents(iBuf);
+				tHarfBuzzBuffers.release(iBuf);
 			}
 		public:
 			uint32_t glyph_count() const
@@ -1082,7 +1100,6 @@ namespace neogfx
 			}
 		private:
 			const graphics_context& iParent;
-			hb_font_t* iFont;
 			const glyph_text_data::glyph_run& iGlyphRun;
 			hb_buffer_t* iBuf;
 			uint32_t iGlyphCount;
@@ -1095,13 +1112,13 @@ namespace neogfx
 		glyph_shapes(const graphics_context& aParent, const font& aFont, const glyph_text_data::glyph_run& aGlyphRun)
 		{
 			font tryFont = aFont;
-			iGlyphsList.emplace_back(glyphs{ aParent, tryFont, aGlyphRun });
+			iGlyphsList.emplace_back(aParent, tryFont, aGlyphRun);
 			while (iGlyphsList.back().needs_fallback_font())
 			{
 				if (tryFont.has_fallback())
 				{
 					tryFont = tryFont.fallback();
-					iGlyphsList.emplace_back(glyphs{ aParent, tryFont, aGlyphRun });
+					iGlyphsList.emplace_back(aParent, tryFont, aGlyphRun);
 				}
 				else
 				{
@@ -1109,7 +1126,7 @@ namespace neogfx
 					for (uint32_t i = 0; i < iGlyphsList.back().glyph_count(); ++i)
 						if (iGlyphsList.back().glyph_info(i).codepoint == 0)
 							lastResort[iGlyphsList.back().glyph_info(i).cluster] = neolib::INVALID_CHAR32; // replacement character
-					iGlyphsList.emplace_back(glyphs{ aParent, aFont, glyph_text_data::glyph_run{&lastResort[0], &lastResort[0] + lastResort.size(), std::get<2>(aGlyphRun), std::get<3>(aGlyphRun), std::get<4>(aGlyphRun) } });
+					iGlyphsList.emplace_back(aParent, aFont, glyph_text_data::glyph_run{&lastResort[0], &lastResort[0] + lastResort.size(), std::get<2>(aGlyphRun), std::get<3>(aGlyphRun), std::get<4>(aGlyphRun) });
 					break;
 				}
 			}
@@ -1207,7 +1224,7 @@ namespace neogfx
 		});
 	}
 
-	glyph_text::container graphics_context::to_glyph_text_impl(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, std::function<font(std::u32string::size_type)> aFontSelector) const
+	glyph_text::container graphics_context::to_glyph_text_impl(std::u32string::const_iterator aTextBegin, std::u32string::const_iterator aTextEnd, std::function<font(std::u32string::size_type)> aFontSelector, bool aUseTextures) const
 	{
 		auto& result = iGlyphTextData->iGlyphTextResult;
 		result.clear();
@@ -1419,6 +1436,9 @@ namespace neogfx
 			previousFont = currentFont;
 		}
 
+		if (hasEmojis && !aUseTextures)
+			return result; // emoji glyphs are emoji atlas textures
+
 		for (std::size_t i = 1; i < runs.size(); ++i)
 		{
 			int j = i - 1;
@@ -1496,13 +1516,15 @@ namespace neogfx
 					result.back().set_subpixel(true);
 				if (drawMnemonic && ((j == 0 && std::get<2>(runs[i]) == text_direction::LTR) || (j == shapes.glyph_count() - 1 && std::get<2>(runs[i]) == text_direction::RTL)))
 					result.back().set_mnemonic(true);
-				if (result.back().category() != text_category::Whitespace && result.back().category() != text_category::Emoji)
+				if (aUseTextures && result.back().category() != text_category::Whitespace && result.back().category() != text_category::Emoji)
 				{
 					auto& glyph = result.back();
+					const i_glyph_texture& glyphTexture = aFontSelector(startCluster).native_font_face().glyph_texture(glyph);
+					auto const visibleExtent = glyph.offset().cx + glyphTexture.placement().x + glyphTexture.texture().extents().cx;
+					glyph.set_visible_extent(static_cast<float>(visibleExtent));
 					if (glyph.advance() != advance.ceil())
 					{
-						const i_glyph_texture& glyphTexture = aFontSelector(startCluster).native_font_face().glyph_texture(glyph);
-						auto visibleAdvance = std::ceil(glyph.offset().cx + glyphTexture.placement().x + glyphTexture.texture().extents().cx);
+						auto visibleAdvance = std::ceil(visibleExtent);
 						if (visibleAdvance > advance.cx)
 						{
 							advance.cx = visibleAdvance;
@@ -1578,6 +1600,202 @@ namespace neogfx
 		return std::move(result);
 	}
 
+	namespace
+	{
+		// Measurements are cached process wide so that layout, which measures the same strings over and over, does not
+		// have to shape the text (and materialise a glyph_text) each time. Results are held in device units.
+		class text_metrics_cache
+		{
+		public:
+			struct key
+			{
+				std::string text;
+				font textFont;
+				bool multiline;
+				dimension maxWidth;
+				bool subpixel;
+				char mnemonic;
+				std::string passwordMask;
+				bool operator<(const key& aOther) const
+				{
+					return std::tie(multiline, maxWidth, subpixel, mnemonic, passwordMask, text, textFont) <
+						std::tie(aOther.multiline, aOther.maxWidth, aOther.subpixel, aOther.mnemonic, aOther.passwordMask, aOther.text, aOther.textFont);
+				}
+			};
+		private:
+			typedef std::list<std::pair<key, text_metrics>> entry_list;
+			typedef std::map<std::reference_wrapper<const key>, entry_list::iterator, std::less<key>> entry_index;
+			static constexpr std::size_t Capacity = 4096;
+		public:
+			const text_metrics* find(const key& aKey)
+			{
+				auto existing = iIndex.find(aKey);
+				if (existing == iIndex.end())
+					return nullptr;
+				iEntries.splice(iEntries.begin(), iEntries, existing->second);
+				return &existing->second->second;
+			}
+			const text_metrics& insert(key&& aKey, text_metrics&& aMetrics)
+			{
+				if (iEntries.size() >= Capacity)
+				{
+					iIndex.erase(iEntries.back().first);
+					iEntries.pop_back();
+				}
+				iEntries.emplace_front(std::move(aKey), std::move(aMetrics));
+				iIndex.emplace(iEntries.front().first, iEntries.begin());
+				return iEntries.front().second;
+			}
+		private:
+			entry_list iEntries;
+			entry_index iIndex;
+		};
+
+		text_metrics_cache& text_metrics_cache_instance()
+		{
+			static text_metrics_cache sCache;
+			return sCache;
+		}
+
+		template <typename Iter>
+		glyph::source_type line_source(Iter aBegin, Iter aEnd)
+		{
+			if (aBegin == aEnd)
+				return glyph::source_type{};
+			glyph::source_type result{ aBegin->source() };
+			for (Iter i = aBegin; i != aEnd; ++i)
+			{
+				result.first = std::min(result.first, i->source().first);
+				result.second = std::max(result.second, i->source().second);
+			}
+			return result;
+		}
+
+		template <typename Iter>
+		dimension line_baseline(Iter aBegin, Iter aEnd, const font& aFont)
+		{
+			dimension result = aFont.height() + aFont.descender();
+			for (Iter i = aBegin; i != aEnd; ++i)
+				if (i->has_font())
+					result = std::max(result, i->font().height() + i->font().descender());
+			return result;
+		}
+	}
+
+	const text_metrics& graphics_context::device_text_metrics(string::const_iterator aTextBegin, string::const_iterator aTextEnd, const font& aFont, bool aMultiline, dimension aMaxWidth) const
+	{
+		text_metrics_cache::key key{ 
+			std::string{ aTextBegin, aTextEnd }, 
+			aFont, 
+			aMultiline, 
+			aMaxWidth, 
+			is_subpixel_rendering_on(), 
+			iMnemonic != std::nullopt ? iMnemonic->second : '\0',
+			password() ? password_mask() : std::string{} };
+		auto& cache = text_metrics_cache_instance();
+		auto existing = cache.find(key);
+		if (existing != nullptr)
+			return *existing;
+		return cache.insert(std::move(key), compute_text_metrics(to_glyph_text(aTextBegin, aTextEnd, aFont), aFont, aMultiline, aMaxWidth));
+	}
+
+	text_metrics graphics_context::compute_text_metrics(const glyph_text& aGlyphText, const font& aFont, bool aMultiline, dimension aMaxWidth) const
+	{
+		text_metrics result;
+		if (!aMultiline)
+		{
+			result.extents = aGlyphText.extents();
+			if (result.extents.cy == 0.0)
+				result.extents.cy = aFont.height();
+			result.lines.push_back(text_line_metrics{ line_source(aGlyphText.cbegin(), aGlyphText.cend()), result.extents, line_baseline(aGlyphText.cbegin(), aGlyphText.cend(), aFont) });
+			return result;
+		}
+		typedef std::pair<glyph_text::const_iterator, glyph_text::const_iterator> line_t;
+		typedef std::vector<line_t> lines_t;
+		lines_t lines;
+		std::array<glyph, 2> delimeters = { glyph{ text_category::Whitespace, '\r' }, glyph{ text_category::Whitespace, '\n' } };
+		neolib::tokens(aGlyphText.cbegin(), aGlyphText.cend(), delimeters.begin(), delimeters.end(), lines, 0, false);
+		for (lines_t::const_iterator i = lines.begin(); i != lines.end(); ++i)
+		{
+			if (aMaxWidth == 0)
+			{
+				size lineExtent = glyph_text::extents(i->first, i->second);
+				result.extents.cx = std::max(result.extents.cx, lineExtent.cx);
+				result.extents.cy += lineExtent.cy;
+				result.lines.push_back(text_line_metrics{ line_source(i->first, i->second), lineExtent, line_baseline(i->first, i->second, aFont) });
+			}
+			else if (i->first != i->second)
+			{
+				glyph_text::const_iterator next = i->first;
+				glyph_text::const_iterator lineStart = next;
+				glyph_text::const_iterator lineEnd = i->second;
+				dimension lineWidth = 0;
+				bool gotLine = false;
+				while (next != i->second)
+				{
+					if (lineWidth + next->extents().cx > aMaxWidth)
+					{
+						if (next != lineStart)
+						{
+							std::pair<glyph_text::const_iterator, glyph_text::const_iterator> wordBreak = aGlyphText.word_break(lineStart, next);
+							lineWidth -= glyph_text::extents(wordBreak.first, next, false).cx;
+							lineEnd = wordBreak.first;
+							next = wordBreak.second;
+							if (lineEnd == next)
+							{
+								while (lineEnd != i->second && (lineEnd + 1)->source() == wordBreak.first->source())
+									++lineEnd;
+								next = lineEnd;
+							}
+						}
+						else
+						{
+							lineWidth += next->advance().cx;
+							++next;
+						}
+						gotLine = true;
+					}
+					else
+					{
+						lineWidth += next->advance().cx;
+						++next;
+					}
+					if (gotLine || next == i->second)
+					{
+						lineWidth += (std::prev(next)->extents().cx - std::prev(next)->advance().cx);
+						size lineExtent{ lineWidth, glyph_text::extents(i->first, i->second).cy };
+						result.extents.cx = std::max(result.extents.cx, lineExtent.cx);
+						result.extents.cy += lineExtent.cy;
+						result.lines.push_back(text_line_metrics{ line_source(lineStart, lineEnd), lineExtent, line_baseline(lineStart, lineEnd, aFont) });
+						lineStart = next;
+						lineEnd = i->second;
+						lineWidth = 0;
+						gotLine = false;
+					}
+				}
+			}
+			else
+			{
+				result.extents.cy += aFont.height();
+				result.lines.push_back(text_line_metrics{ line_source(i->first, i->second), size{ 0.0, aFont.height() }, line_baseline(i->first, i->second, aFont) });
+			}
+		}
+		if (result.extents.cy == 0)
+			result.extents.cy = aFont.height();
+		return result;
+	}
+
+	text_metrics graphics_context::from_device_units(const text_metrics& aMetrics) const
+	{
+		text_metrics result{ from_device_units(aMetrics.extents), aMetrics.lines };
+		for (auto& line : result.lines)
+		{
+			line.extents = from_device_units(line.extents);
+			line.baseline = from_device_units(size{ 0.0, line.baseline }).cy;
+		}
+		return result;
+	}
+
 	scoped_coordinate_system::scoped_coordinate_system(graphics_context& aGc, const point& aOrigin, const size& aExtents, logical_coordinate_system aCoordinateSystem) :
 		iGc(aGc), iPreviousCoordinateSystem(aGc.logical_coordinate_system()), iPreviousCoordinates(aGc.logical_coordinates())
 	{
@@ -62,6 +62,7 @@ namespace neogfx
 			void* aux_handle() const override { return iFontFace.aux_handle(); }
 			uint32_t glyph_index(char32_t aCodePoint) const override { return iFontFace.glyph_index(aCodePoint); }
 			i_glyph_texture& glyph_texture(const glyph& aGlyph) const override { return iFontFace.glyph_texture(aGlyph); }
+			const neogfx::glyph_cache_statistics& glyph_cache_statistics() const override { return iFontFace.glyph_cache_statistics(); }
 		public:
 			void add_ref() override { iFontFace.add_ref(); }
 			void release() override { iFontFace.release(); }
@@ -146,7 +147,10 @@ namespace neogfx
 		iDefaultFallbackFontInfo{ detail::platform_specific::default_fallback_font_info() },
 		iGlyphAtlas{ aRenderingEngine.texture_manager(), size{1024.0, 1024.0} },
 		iNextAvailableToken{ 1u },
-		iEmojiAtlas{ aRenderingEngine.texture_manager() }
+		iEmojiAtlas{ aRenderingEngine.texture_manager() },
+		iGlyphCacheBudget{ 64u * 1024u * 1024u, 65536u, 60u },
+		iGlyphCacheStatistics{},
+		iGlyphCacheFrame{ 0u }
 	{
 		FT_Error error = FT_Init_FreeType(&iFontLib);
 		if (error)
@@ -357,6 +361,8 @@ namespace neogfx
 
 	font::token font_manager::get_token(const font& aFont)
 	{
+		// glyphs take and return font tokens and text can be shaped off the UI thread (see graphics_context::shape_text)
+		std::lock_guard<std::recursive_mutex> lock{ iFontTokenMutex };
 		auto cacheIter = iFontTokenCache.find(aFont);
 		if (cacheIter == iFontTokenCache.end())
 		{
@@ -381,6 +387,7 @@ namespace neogfx
 
 	void font_manager::copy_token(font::token aToken)
 	{
+		std::lock_guard<std::recursive_mutex> lock{ iFontTokenMutex };
 		auto tokenIter = iFontTokens.find(aToken);
 		if (tokenIter == iFontTokens.end())
 			throw invalid_token();
@@ -389,6 +396,7 @@ namespace neogfx
 
 	void font_manager::return_token(font::token aToken)
 	{
+		std::lock_guard<std::recursive_mutex> lock{ iFontTokenMutex };
 		auto tokenIter = iFontTokens.find(aToken);
 		if (tokenIter == iFontTokens.end())
 			throw invalid_token();
@@ -401,6 +409,7 @@ namespace neogfx
 
 	const font& font_manager::from_token(font::token aToken)
 	{
+		std::lock_guard<std::recursive_mutex> lock{ iFontTokenMutex };
 		auto tokenIter = iFontTokens.find(aToken);
 		if (tokenIter == iFontTokens.end())
 			throw invalid_token();
@@ -427,6 +436,70 @@ namespace neogfx
 		return iEmojiAtlas;
 	}
 
+	const glyph_cache_budget& font_manager::glyph_cache_budget() const
+	{
+		return iGlyphCacheBudget;
+	}
+
+	void font_manager::set_glyph_cache_budget(const neogfx::glyph_cache_budget& aBudget)
+	{
+		iGlyphCacheBudget = aBudget;
+		trim_glyph_cache(0u, 0u);
+	}
+
+	const glyph_cache_statistics& font_manager::glyph_cache_statistics() const
+	{
+		return iGlyphCacheStatistics;
+	}
+
+	uint64_t font_manager::glyph_cache_frame() const
+	{
+		return iGlyphCacheFrame;
+	}
+
+	void font_manager::advance_glyph_cache_frame()
+	{
+		++iGlyphCacheFrame;
+	}
+
+	font_manager::glyph_cache_lru::iterator font_manager::cache_glyph(const native_font_face& aFace, const std::pair<uint32_t, bool>& aGlyph, uint64_t aAtlasBytes)
+	{
+		++iGlyphCacheStatistics.entries;
+		iGlyphCacheStatistics.atlasBytes += aAtlasBytes;
+		++iGlyphCacheStatistics.misses;
+		return iGlyphCacheLru.insert(iGlyphCacheLru.begin(), glyph_cache_entry{ &aFace, aGlyph, aAtlasBytes, iGlyphCacheFrame });
+	}
+
+	void font_manager::use_cached_glyph(glyph_cache_lru::iterator aEntry)
+	{
+		++iGlyphCacheStatistics.hits;
+		aEntry->lastUsedFrame = iGlyphCacheFrame;
+		if (aEntry != iGlyphCacheLru.begin())
+			iGlyphCacheLru.splice(iGlyphCacheLru.begin(), iGlyphCacheLru, aEntry);
+	}
+
+	void font_manager::uncache_glyph(glyph_cache_lru::iterator aEntry)
+	{
+		--iGlyphCacheStatistics.entries;
+		iGlyphCacheStatistics.atlasBytes -= aEntry->atlasBytes;
+		iGlyphCacheLru.erase(aEntry);
+	}
+
+	void font_manager::trim_glyph_cache(uint32_t aEntriesNeeded, uint64_t aAtlasBytesNeeded)
+	{
+		// Glyphs used within the last "minimumAge" frames are never evicted: their textures may still be referenced
+		// by glyph batches queued for the current frame so the cache is allowed to exceed its budget instead.
+		while (!iGlyphCacheLru.empty() && 
+			(iGlyphCacheStatistics.entries + aEntriesNeeded > iGlyphCacheBudget.entries || iGlyphCacheStatistics.atlasBytes + aAtlasBytesNeeded > iGlyphCacheBudget.atlasBytes))
+		{
+			auto& oldest = iGlyphCacheLru.back();
+			if (oldest.lastUsedFrame + iGlyphCacheBudget.minimumAge > iGlyphCacheFrame)
+				break;
+			++iGlyphCacheStatistics.evictions;
+			oldest.face->evict_glyph(oldest.glyph);
+		}
+	}
+
 	i_native_font& font_manager::find_font(const std::string& aFamilyName, const std::string& aStyleName, font::point_size aSize)
 	{
 		auto family = iFontFamilies.find(neolib::make_ci_string(aFamilyName));
@@ -0,0 +1,273 @@
+// glyph_bitmap.cpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+#include <cstring>
+#include <algorithm>
+#include "glyph_bitmap.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NEOGFX_GLYPH_BITMAP_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define NEOGFX_TARGET_SSE2
+#define NEOGFX_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define NEOGFX_TARGET_SSE2 __attribute__((target("sse2")))
+#define NEOGFX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace neogfx
+{
+	namespace
+	{
+		typedef void(*row_converter)(const uint8_t* aSource, uint32_t aWidth, uint8_t* aDestination);
+
+		struct row_converters
+		{
+			glyph_bitmap_instruction_set instructionSet;
+			row_converter mono;
+			row_converter subpixel;
+		};
+
+		// Sub-pixel FIR filter with coefficients { 1.5/16, 3/16, 7/16, 3/16, 1.5/16 }; each tap is truncated
+		// individually which is exactly (v * 3) >> 5, (v * 3) >> 4 and (v * 7) >> 4 in integer arithmetic.
+		inline uint8_t subpixel_filter(uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t e)
+		{
+			return static_cast<uint8_t>(((a * 3) >> 5) + ((b * 3) >> 4) + ((c * 7) >> 4) + ((d * 3) >> 4) + ((e * 3) >> 5));
+		}
+
+		inline void subpixel_filter_at(const uint8_t* aSource, uint32_t aWidth, uint32_t x, uint8_t* aDestination)
+		{
+			auto tap = [aSource, aWidth, x](int32_t z) -> uint32_t 
+			{ 
+				return aSource[std::max<int32_t>(0, std::min<int32_t>(aWidth - 1, x + z))]; 
+			};
+			aDestination[(x / 3) * 4 + x % 3] = subpixel_filter(tap(-2), tap(-1), tap(0), tap(1), tap(2));
+		}
+
+		inline void scatter_subpixels(const uint8_t* aFiltered, uint32_t aCount, uint32_t x, uint8_t* aDestination)
+		{
+			for (uint32_t i = 0; i < aCount; ++i, ++x)
+				aDestination[(x / 3) * 4 + x % 3] = aFiltered[i];
+		}
+
+		void convert_mono_row_scalar(const uint8_t* aSource, uint32_t aWidth, uint8_t* aDestination)
+		{
+			for (uint32_t x = 0; x < aWidth; ++x)
+				aDestination[x] = (aSource[x / 8] & (1 << (7 - x % 8))) != 0 ? 0xFF : 0x00;
+		}
+
+		void convert_subpixel_row_scalar(const uint8_t* aSource, uint32_t aWidth, uint8_t* aDestination)
+		{
+			for (uint32_t x = 0; x < aWidth; ++x)
+				subpixel_filter_at(aSource, aWidth, x, aDestination);
+		}
+
+#ifdef NEOGFX_GLYPH_BITMAP_X86
+		NEOGFX_TARGET_SSE2 void convert_mono_row_sse2(const uint8_t* aSource, uint32_t aWidth, uint8_t* aDestination)
+		{
+			const __m128i mask = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+			uint32_t x = 0;
+			for (; x + 16 <= aWidth; x += 16)
+			{
+				const __m128i bits = _mm_set_epi64x(
+					static_cast<long long>(0x0101010101010101ull * aSource[x / 8 + 1]),
+					static_cast<long long>(0x0101010101010101ull * aSource[x / 8]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(aDestination + x), _mm_cmpeq_epi8(_mm_and_si128(bits, mask), mask));
+			}
+			for (; x < aWidth; ++x)
+				aDestination[x] = (aSource[x / 8] & (1 << (7 - x % 8))) != 0 ? 0xFF : 0x00;
+		}
+
+		NEOGFX_TARGET_SSE2 inline __m128i subpixel_filter_sse2(__m128i a, __m128i b, __m128i c, __m128i d, __m128i e)
+		{
+			const __m128i three = _mm_set1_epi16(3);
+			const __m128i seven = _mm_set1_epi16(7);
+			__m128i result = _mm_srli_epi16(_mm_mullo_epi16(a, three), 5);
+			result = _mm_add_epi16(result, _mm_srli_epi16(_mm_mullo_epi16(b, three), 4));
+			result = _mm_add_epi16(result, _mm_srli_epi16(_mm_mullo_epi16(c, seven), 4));
+			result = _mm_add_epi16(result, _mm_srli_epi16(_mm_mullo_epi16(d, three), 4));
+			return _mm_add_epi16(result, _mm_srli_epi16(_mm_mullo_epi16(e, three), 5));
+		}
+
+		NEOGFX_TARGET_SSE2 void convert_subpixel_row_sse2(const uint8_t* aSource, uint32_t aWidth, uint8_t* aDestination)
+		{
+			alignas(16) uint8_t filtered[16];
+			const __m128i zero = _mm_setzero_si128();
+			uint32_t x = 0;
+			for (; x < std::min(aWidth, 2u); ++x)
+				subpixel_filter_at(aSource, aWidth, x, aDestination);
+			for (; x + 18 <= aWidth; x += 16)
+			{
+				__m128i taps[5];
+				for (int32_t z = -2; z <= 2; ++z)
+					taps[z + 2] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSource + x + z));
+				__m128i lo = subpixel_filter_sse2(
+					_mm_unpacklo_epi8(taps[0], zero), _mm_unpacklo_epi8(taps[1], zero), _mm_unpacklo_epi8(taps[2], zero),
+					_mm_unpacklo_epi8(taps[3], zero), _mm_unpacklo_epi8(taps[4], zero));
+				__m128i hi = subpixel_filter_sse2(
+					_mm_unpackhi_epi8(taps[0], zero), _mm_unpackhi_epi8(taps[1], zero), _mm_unpackhi_epi8(taps[2], zero),
+					_mm_unpackhi_epi8(taps[3], zero), _mm_unpackhi_epi8(taps[4], zero));
+				_mm_store_si128(reinterpret_cast<__m128i*>(filtered), _mm_packus_epi16(lo, hi));
+				scatter_subpixels(filtered, 16, x, aDestination);
+			}
+			for (; x < aWidth; ++x)
+				subpixel_filter_at(aSource, aWidth, x, aDestination);
+		}
+
+		NEOGFX_TARGET_AVX2 void convert_mono_row_avx2(const uint8_t* aSource, uint32_t aWidth, uint8_t* aDestination)
+		{
+			const __m256i mask = _mm256_set_epi8(
+				1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+				1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+			uint32_t x = 0;
+			for (; x + 32 <= aWidth; x += 32)
+			{
+				const __m256i bits = _mm256_set_epi64x(
+					static_cast<long long>(0x0101010101010101ull * aSource[x / 8 + 3]),
+					static_cast<long long>(0x0101010101010101ull * aSource[x / 8 + 2]),
+					static_cast<long long>(0x0101010101010101ull * aSource[x / 8 + 1]),
+					static_cast<long long>(0x0101010101010101ull * aSource[x / 8]));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(aDestination + x), _mm256_cmpeq_epi8(_mm256_and_si256(bits, mask), mask));
+			}
+			for (; x < aWidth; ++x)
+				aDestination[x] = (aSource[x / 8] & (1 << (7 - x % 8))) != 0 ? 0xFF : 0x00;
+		}
+
+		NEOGFX_TARGET_AVX2 inline __m256i subpixel_tap_avx2(const uint8_t* aSource, int32_t aOffset, __m256i aCoefficient, int aShift)
+		{
+			const __m256i tap = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSource + aOffset)));
+			return _mm256_srli_epi16(_mm256_mullo_epi16(tap, aCoefficient), aShift);
+		}
+
+		NEOGFX_TARGET_AVX2 inline __m256i subpixel_filter_avx2(const uint8_t* aSource)
+		{
+			const __m256i three = _mm256_set1_epi16(3);
+			const __m256i seven = _mm256_set1_epi16(7);
+			__m256i result = subpixel_tap_avx2(aSource, -2, three, 5);
+			result = _mm256_add_epi16(result, subpixel_tap_avx2(aSource, -1, three, 4));
+			result = _mm256_add_epi16(result, subpixel_tap_avx2(aSource, 0, seven, 4));
+			result = _mm256_add_epi16(result, subpixel_tap_avx2(aSource, 1, three, 4));
+			return _mm256_add_epi16(result, subpixel_tap_avx2(aSource, 2, three, 5));
+		}
+
+		NEOGFX_TARGET_AVX2 void convert_subpixel_row_avx2(const uint8_t* aSource, uint32_t aWidth, uint8_t* aDestination)
+		{
+			alignas(32) uint8_t filtered[32];
+			uint32_t x = 0;
+			for (; x < std::min(aWidth, 2u); ++x)
+				subpixel_filter_at(aSource, aWidth, x, aDestination);
+			for (; x + 34 <= aWidth; x += 32)
+			{
+				__m256i lo = subpixel_filter_avx2(aSource + x);
+				__m256i hi = subpixel_filter_avx2(aSource + x + 16);
+				_mm_store_si128(reinterpret_cast<__m128i*>(filtered), 
+					_mm_packus_epi16(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1)));
+				_mm_store_si128(reinterpret_cast<__m128i*>(filtered + 16), 
+					_mm_packus_epi16(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1)));
+				scatter_subpixels(filtered, 32, x, aDestination);
+			}
+			for (; x < aWidth; ++x)
+				subpixel_filter_at(aSource, aWidth, x, aDestination);
+		}
+
+		bool cpu_has_avx2()
+		{
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+			__cpuid(info, 1);
+			bool const osxsave = (info[2] & (1 << 27)) != 0;
+			bool const avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+				return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+
+		bool cpu_has_sse2()
+		{
+#if defined(_M_X64) || defined(__x86_64__)
+			return true;
+#elif defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			return (info[3] & (1 << 26)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("sse2") != 0;
+#endif
+		}
+#endif
+
+		row_converters select_row_converters()
+		{
+#ifdef NEOGFX_GLYPH_BITMAP_X86
+			if (cpu_has_avx2())
+				return row_converters{ glyph_bitmap_instruction_set::AVX2, &convert_mono_row_avx2, &convert_subpixel_row_avx2 };
+			if (cpu_has_sse2())
+				return row_converters{ glyph_bitmap_instruction_set::SSE2, &convert_mono_row_sse2, &convert_subpixel_row_sse2 };
+#endif
+			return row_converters{ glyph_bitmap_instruction_set::Scalar, &convert_mono_row_scalar, &convert_subpixel_row_scalar };
+		}
+
+		const row_converters& active_row_converters()
+		{
+			static const row_converters sConverters = select_row_converters();
+			return sConverters;
+		}
+	}
+
+	glyph_bitmap_instruction_set glyph_bitmap_conversion_instruction_set()
+	{
+		return active_row_converters().instructionSet;
+	}
+
+	void convert_glyph_bitmap(glyph_bitmap_format aFormat, const uint8_t* aSource, uint32_t aWidth, uint32_t aRows, int32_t aSourcePitch, uint8_t* aDestination, std::size_t aDestinationPitch)
+	{
+		if (aWidth == 0 || aRows == 0)
+			return;
+		const auto& converters = active_row_converters();
+		for (uint32_t y = 0; y < aRows; ++y, aSource += aSourcePitch, aDestination += aDestinationPitch)
+		{
+			switch (aFormat)
+			{
+			case glyph_bitmap_format::Mono:
+				converters.mono(aSource, aWidth, aDestination);
+				break;
+			case glyph_bitmap_format::Grey:
+				std::memcpy(aDestination, aSource, aWidth);
+				break;
+			case glyph_bitmap_format::Subpixel:
+				converters.subpixel(aSource, aWidth, aDestination);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,47 @@
+// glyph_bitmap.hpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <neogfx/neogfx.hpp>
+
+namespace neogfx
+{
+	enum class glyph_bitmap_format
+	{
+		Mono,		// 1 bit per pixel, MSB first; converted to 8-bit alpha (0x00 or 0xFF)
+		Grey,		// 8 bits per pixel; copied as 8-bit alpha
+		Subpixel	// 8 bits per subpixel (3 per pixel); FIR filtered and converted to RGBA (alpha channel untouched)
+	};
+
+	enum class glyph_bitmap_instruction_set
+	{
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	// Instruction set selected at runtime for glyph bitmap conversion.
+	glyph_bitmap_instruction_set glyph_bitmap_conversion_instruction_set();
+
+	// Converts a FreeType glyph bitmap into texture data. aDestination points at the first destination pixel of the
+	// first row and aDestinationPitch is the byte distance between destination rows. aWidth is the width of the source
+	// bitmap in source units (pixels or, for Subpixel, subpixels).
+	void convert_glyph_bitmap(glyph_bitmap_format aFormat, const uint8_t* aSource, uint32_t aWidth, uint32_t aRows, int32_t aSourcePitch, uint8_t* aDestination, std::size_t aDestinationPitch);
+}
@@ -22,6 +22,7 @@
 #include <neogfx/neogfx.hpp>
 #include <neogfx/core/geometrical.hpp>
 #include <neogfx/gfx/text/font.hpp>
+#include <neogfx/gfx/text/i_font_manager.hpp>
 
 namespace neogfx
 {
@@ -62,6 +63,7 @@ namespace neogfx
 		virtual void* aux_handle() const = 0;
 		virtual uint32_t glyph_index(char32_t aCodePoint) const = 0;
 		virtual i_glyph_texture& glyph_texture(const glyph& aGlyph) const = 0;
+		virtual const neogfx::glyph_cache_statistics& glyph_cache_statistics() const = 0;
 	public:
 		virtual void add_ref() = 0;
 		virtual void release() = 0;
@@ -18,30 +18,28 @@
 */
 
 #include <neogfx/neogfx.hpp>
-#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
 #include "native_font.hpp"
 #include "native_font_face.hpp"
 
 namespace neogfx
 {
 	native_font::native_font(i_rendering_engine& aRenderingEngine, FT_Library aFontLib, const std::string aFileName) :
-		iRenderingEngine(aRenderingEngine), iFontLib(aFontLib), iSource(filename_type(aFileName)), iCache{}, iFaceCount(0)
+		iRenderingEngine(aRenderingEngine), iFontLib(aFontLib), iSource(filename_type(aFileName)), iFileMapping{}, iFaceCount(0)
 	{
 		register_face(0);
 		for (FT_Long f = 1; f < iFaceCount; ++f)
 			register_face(f);
-		iCache.clear();
-		iCache.shrink_to_fit();
+		iFileMapping.reset();
 	}
 
 	native_font::native_font(i_rendering_engine& aRenderingEngine, FT_Library aFontLib, const void* aData, std::size_t aSizeInBytes) :
-		iRenderingEngine(aRenderingEngine), iFontLib(aFontLib), iSource(memory_block_type(aData, aSizeInBytes)), iCache{}, iFaceCount(0)
+		iRenderingEngine(aRenderingEngine), iFontLib(aFontLib), iSource(memory_block_type(aData, aSizeInBytes)), iFileMapping{}, iFaceCount(0)
 	{
 		register_face(0);
 		for (FT_Long f = 1; f < iFaceCount; ++f)
 			register_face(f);
-		iCache.clear();
-		iCache.shrink_to_fit();
+		iFileMapping.reset();
 	}
 
 	native_font::~native_font()
@@ -144,11 +142,6 @@ namespace neogfx
 			iFaceUsage.erase(iFaceUsage.find(&aFace));
 			aFace.update_handle(nullptr);
 		}
-		if (iFaceUsage.empty())
-		{
-			iCache.clear();
-			iCache.shrink_to_fit();
-		}
 	}
 
 	void native_font::register_face(FT_Long aFaceIndex)
@@ -178,38 +171,41 @@ namespace neogfx
 		close_face(face);
 	}
 
-	FT_Face native_font::open_face(FT_Long aFaceIndex)
+	native_font::memory_block_type native_font::font_data()
 	{
-		FT_Face face;
 		if (std::holds_alternative<filename_type>(iSource))
 		{
-			if (iCache.empty())
+			// The font file is mapped read-only rather than read into a private buffer; the mapping is shared
+			// by every face (style/size) created from this file and stays alive for the lifetime of this object.
+			if (iFileMapping == nullptr)
 			{
-				std::size_t fileSize = static_cast<std::size_t>(boost::filesystem::file_size(static_variant_cast<const filename_type&>(iSource)));
-				iCache.resize(fileSize);
-				std::ifstream file{ static_variant_cast<const filename_type&>(iSource).c_str(), std::ios::in | std::ios::binary };
-				file.read(reinterpret_cast<char*>(&iCache[0]), fileSize);
+				try
+				{
+					boost::interprocess::file_mapping file{ static_variant_cast<const filename_type&>(iSource).c_str(), boost::interprocess::read_only };
+					iFileMapping = std::make_unique<boost::interprocess::mapped_region>(file, boost::interprocess::read_only);
+				}
+				catch (const boost::interprocess::interprocess_exception&)
+				{
+					throw failed_to_load_font();
+				}
 			}
-			FT_Error error = FT_New_Memory_Face(
-				iFontLib,
-				static_cast<const FT_Byte*>(&iCache[0]),
-				iCache.size(),
-				aFaceIndex,
-				&face);
-			if (error)
-				throw failed_to_load_font();
-		}
-		else
-		{
-			FT_Error error = FT_New_Memory_Face(
-				iFontLib,
-				static_cast<const FT_Byte*>(static_variant_cast<const memory_block_type&>(iSource).first),
-				static_variant_cast<const memory_block_type&>(iSource).second,
-				aFaceIndex,
-				&face);
-			if (error)
-				throw failed_to_load_font();
+			return memory_block_type{ iFileMapping->get_address(), iFileMapping->get_size() };
 		}
+		return static_variant_cast<const memory_block_type&>(iSource);
+	}
+
+	FT_Face native_font::open_face(FT_Long aFaceIndex)
+	{
+		FT_Face face;
+		auto data = font_data();
+		FT_Error error = FT_New_Memory_Face(
+			iFontLib,
+			static_cast<const FT_Byte*>(data.first),
+			static_cast<FT_Long>(data.second),
+			aFaceIndex,
+			&face);
+		if (error)
+			throw failed_to_load_font();
 		return face;
 	}
 
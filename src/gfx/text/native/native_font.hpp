@@ -23,6 +23,7 @@
 #include <unordered_map>
 #include <tuple>
 #include <neolib/variant.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include "i_native_font.hpp"
@@ -62,6 +63,7 @@ namespace neogfx
 		virtual void release(i_native_font_face& aFace);
 	private:
 		void register_face(FT_Long aFaceIndex);
+		memory_block_type font_data();
 		FT_Face open_face(FT_Long aFaceIndex);
 		void close_face(FT_Face aFace);
 		i_native_font_face& create_face(FT_Long aFaceIndex, font::style_e aStyle, font::point_size aSize, const i_device_resolution& aDevice);
@@ -69,7 +71,7 @@ namespace neogfx
 		i_rendering_engine& iRenderingEngine;
 		FT_Library iFontLib;
 		source_type iSource;
-		std::vector<unsigned char> iCache;
+		std::unique_ptr<boost::interprocess::mapped_region> iFileMapping;
 		std::string iFamilyName;
 		FT_Long iFaceCount;
 		style_map iStyleMap;
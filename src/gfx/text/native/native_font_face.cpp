@@ -29,6 +29,7 @@
 #include "../../native/opengl.hpp"
 #include "../../native/i_native_texture.hpp"
 #include "native_font_face.hpp"
+#include "glyph_bitmap.hpp"
 #include <neogfx/gfx/text/glyph.hpp>
 #include <neogfx/gfx/i_rendering_engine.hpp>
 
@@ -36,10 +37,6 @@ namespace neogfx
 {
 	namespace
 	{
-		typedef std::unordered_map<std::pair<FT_UInt, FT_Int32>, FT_Fixed, boost::hash<std::pair<FT_UInt, FT_Int32>>> get_advance_cache_face;
-		typedef std::unordered_map<FT_Face, get_advance_cache_face> get_advance_cache;
-		get_advance_cache sGetAdvanceCache;
-
 		extern "C"
 		{
 			FT_EXPORT(FT_Error) orig_FT_Get_Advance(FT_Face face, FT_UInt gindex, FT_Int32 load_flags, FT_Fixed* padvance);
@@ -47,20 +44,10 @@ namespace neogfx
 
 		FT_Error neogfx_FT_Get_Advance(FT_Face face, FT_UInt gindex, FT_Int32 load_flags, FT_Fixed* padvance)
 		{
-			auto cachedFace = sGetAdvanceCache.find(face);
-			if (cachedFace != sGetAdvanceCache.end())
-			{
-				auto entry = cachedFace->second.find(std::make_pair(gindex, load_flags));
-				if (entry != cachedFace->second.end())
-				{
-					*padvance = entry->second;
-					return FT_Err_Ok;
-				}
-				auto result = orig_FT_Get_Advance(face, gindex, load_flags, padvance);
-				if (result == FT_Err_Ok)
-					cachedFace->second[std::make_pair(gindex, load_flags)] = *padvance;
-				return result;
-			}
+			// faces owned by a native_font_face are tagged with it (see native_font_face::update_handle)
+			auto fontFace = static_cast<const native_font_face*>(face->generic.data);
+			if (fontFace != nullptr)
+				return fontFace->get_advance(gindex, load_flags, *padvance);
 			auto result = orig_FT_Get_Advance(face, gindex, load_flags, padvance);
 			freetypeCheck(result);
 			return result;
@@ -73,22 +60,79 @@ namespace neogfx
 				return neogfx_FT_Get_Advance(face, gindex, load_flags, padvance);
 			}
 		}
+
+		inline uint64_t kerning_key(uint32_t aLeftGlyphIndex, uint32_t aRightGlyphIndex)
+		{
+			return (static_cast<uint64_t>(aLeftGlyphIndex) << 32) | aRightGlyphIndex;
+		}
+	}
+
+	native_font_face::advance_table::advance_table(FT_Int32 aLoadFlags, FT_Long aGlyphCount) :
+		iLoadFlags{ aLoadFlags }, 
+		iPageCount{ static_cast<uint32_t>((std::max<FT_Long>(aGlyphCount, 1) + PageSize - 1) / PageSize) }, 
+		iPages{ new std::atomic<page*>[iPageCount] }
+	{
+		for (uint32_t p = 0; p < iPageCount; ++p)
+			iPages[p] = nullptr;
+	}
+
+	native_font_face::advance_table::~advance_table()
+	{
+		for (uint32_t p = 0; p < iPageCount; ++p)
+			delete iPages[p].load();
+	}
+
+	FT_Int32 native_font_face::advance_table::load_flags() const
+	{
+		return iLoadFlags;
+	}
+
+	FT_Fixed native_font_face::advance_table::find(FT_UInt aGlyphIndex) const
+	{
+		if (aGlyphIndex / PageSize >= iPageCount)
+			return NotCached;
+		auto existingPage = iPages[aGlyphIndex / PageSize].load(std::memory_order_acquire);
+		if (existingPage == nullptr)
+			return NotCached;
+		return (*existingPage)[aGlyphIndex % PageSize].load(std::memory_order_relaxed);
+	}
+
+	void native_font_face::advance_table::insert(FT_UInt aGlyphIndex, FT_Fixed aAdvance)
+	{
+		if (aGlyphIndex / PageSize >= iPageCount)
+			return;
+		auto& pageSlot = iPages[aGlyphIndex / PageSize];
+		auto existingPage = pageSlot.load(std::memory_order_acquire);
+		if (existingPage == nullptr)
+		{
+			auto newPage = std::make_unique<page>();
+			for (auto& advance : *newPage)
+				advance.store(NotCached, std::memory_order_relaxed);
+			if (pageSlot.compare_exchange_strong(existingPage, newPage.get(), std::memory_order_acq_rel))
+				existingPage = newPage.release();
+		}
+		(*existingPage)[aGlyphIndex % PageSize].store(aAdvance, std::memory_order_relaxed);
 	}
 
 	native_font_face::native_font_face(i_rendering_engine& aRenderingEngine, i_native_font& aFont, font::style_e aStyle, font::point_size aSize, neogfx::size aDpiResolution, FT_Face aHandle) :
-		iRenderingEngine(aRenderingEngine), iFont(aFont), iStyle(aStyle), iStyleName(aHandle->style_name), iSize(aSize), iPixelDensityDpi(aDpiResolution), iHandle(aHandle), iHasKerning(!!FT_HAS_KERNING(iHandle))
+		iRenderingEngine(aRenderingEngine), iFont(aFont), iStyle(aStyle), iStyleName(aHandle->style_name), iSize(aSize), iPixelDensityDpi(aDpiResolution), iHandle(aHandle), iGlyphCacheStatistics{}, iHasKerning(!!FT_HAS_KERNING(iHandle))
 	{
+		for (auto& table : iAdvanceTables)
+			table = nullptr;
+		iHandle->generic.data = this;
+		iHandle->generic.finalizer = nullptr;
 		set_metrics();
-		sGetAdvanceCache[iHandle] = get_advance_cache_face{};
 	}
 
 	native_font_face::~native_font_face()
 	{
-		if (iHandle != nullptr)
-			sGetAdvanceCache.erase(sGetAdvanceCache.find(iHandle));
+		while (!iGlyphs.empty())
+			evict_glyph(iGlyphs.begin()->first);
 		FT_Done_Face(iHandle);
 		if (iFallbackFont != nullptr)
 			iFallbackFont->release();
+		for (auto& table : iAdvanceTables)
+			delete table.load();
 	}
 
 	i_native_font& native_font_face::native_font()
@@ -166,12 +210,20 @@ namespace neogfx
 	{
 		if (!iHasKerning)
 			return 0.0;
-		auto existing = iKerningTable.find(std::make_pair(aLeftGlyphIndex, aRightGlyphIndex));
-		if (existing != iKerningTable.end())
-			return existing->second;
+		auto const key = kerning_key(aLeftGlyphIndex, aRightGlyphIndex);
+		{
+			std::shared_lock<std::shared_mutex> lock{ iKerningTableMutex };
+			auto existing = iKerningTable.find(key);
+			if (existing != iKerningTable.end())
+				return existing->second;
+		}
 		FT_Vector delta;
-		freetypeCheck(FT_Get_Kerning(iHandle, aLeftGlyphIndex, aRightGlyphIndex, FT_KERNING_DEFAULT, &delta));
-		return (iKerningTable[std::make_pair(aLeftGlyphIndex, aRightGlyphIndex)] = delta.x / 64.0);
+		{
+			std::lock_guard<std::recursive_mutex> lock{ iFreeTypeMutex };
+			freetypeCheck(FT_Get_Kerning(iHandle, aLeftGlyphIndex, aRightGlyphIndex, FT_KERNING_DEFAULT, &delta));
+		}
+		std::unique_lock<std::shared_mutex> lock{ iKerningTableMutex };
+		return (iKerningTable[key] = static_cast<float>(delta.x / 64.0));
 	}
 
 	bool native_font_face::is_bitmap_font() const
@@ -219,18 +271,21 @@ namespace neogfx
 
 	void native_font_face::update_handle(void* aHandle) 
 	{ 
-		if (iHandle != nullptr)
-			sGetAdvanceCache.erase(sGetAdvanceCache.find(iHandle));
+		std::lock_guard<std::recursive_mutex> lock{ iFreeTypeMutex };
+		// advance and kerning tables are kept: a reopened handle has the same face index and size
 		iHandle = static_cast<FT_Face>(aHandle);
-		if (iHandle != nullptr)
-			sGetAdvanceCache[iHandle] = get_advance_cache_face{};
 		iAuxHandle.reset();
 		if (iHandle != nullptr)
+		{
+			iHandle->generic.data = this;
+			iHandle->generic.finalizer = nullptr;
 			set_metrics();
+		}
 	}
 
 	void* native_font_face::aux_handle() const
 	{
+		std::lock_guard<std::recursive_mutex> lock{ iFreeTypeMutex };
 		if (iAuxHandle == nullptr)
 			iAuxHandle = std::make_unique<hb_handle>(iHandle);
 		return &*iAuxHandle;
@@ -245,8 +300,14 @@ namespace neogfx
 	{
 		auto existingGlyph = iGlyphs.find(std::make_pair(aGlyph.value(), aGlyph.subpixel()));
 		if (existingGlyph != iGlyphs.end())
-			return existingGlyph->second;
+		{
+			++iGlyphCacheStatistics.hits;
+			font_manager().use_cached_glyph(existingGlyph->second.cacheEntry);
+			return existingGlyph->second.texture;
+		}
+		++iGlyphCacheStatistics.misses;
 
+		std::lock_guard<std::recursive_mutex> freeTypeLock{ iFreeTypeMutex };
 		try
 		{
 			freetypeCheck(FT_Load_Glyph(iHandle, aGlyph.value(), FT_LOAD_TARGET_LCD));
@@ -272,61 +333,44 @@ namespace neogfx
 			useSubpixelFiltering = false;
 
 		auto subTextureWidth = bitmap.width / (useSubpixelFiltering ? 3 : 1);
-		auto& subTexture = iRenderingEngine.font_manager().glyph_atlas().create_sub_texture(
+		font_manager().trim_glyph_cache(1u, (subTextureWidth + 2u) * (bitmap.rows + 2u) * 4u);
+		auto& subTexture = font_manager().glyph_atlas().create_sub_texture(
 			neogfx::size{ static_cast<dimension>(subTextureWidth), static_cast<dimension>(bitmap.rows) }.ceil(),
 			1.0, texture_sampling::Normal);
 
 		rect glyphRect{ subTexture.atlas_location() };
-		i_glyph_texture& glyphTexture = iGlyphs.insert(std::make_pair(std::make_pair(aGlyph.value(), aGlyph.subpixel()),
-			neogfx::glyph_texture{
-				subTexture,
-				useSubpixelFiltering,
-				point{
-					iHandle->glyph->metrics.horiBearingX / 64.0,
-					(iHandle->glyph->metrics.horiBearingY - iHandle->glyph->metrics.height) / 64.0 } })).first->second;
-
-		iGlyphTextureData.clear();
-		iGlyphTextureData.resize(static_cast<std::size_t>(glyphRect.cx * glyphRect.cy));
-		iSubpixelGlyphTextureData.clear();
-		iSubpixelGlyphTextureData.resize(static_cast<std::size_t>(glyphRect.cx * glyphRect.cy));
+		auto const glyphKey = std::make_pair(aGlyph.value(), aGlyph.subpixel());
+		auto const atlasBytes = static_cast<uint64_t>(glyphRect.cx * glyphRect.cy) * 4u;
+		i_glyph_texture& glyphTexture = iGlyphs.insert(std::make_pair(glyphKey,
+			cached_glyph{
+				neogfx::glyph_texture{
+					subTexture,
+					useSubpixelFiltering,
+					point{
+						iHandle->glyph->metrics.horiBearingX / 64.0,
+						(iHandle->glyph->metrics.horiBearingY - iHandle->glyph->metrics.height) / 64.0 } },
+				font_manager().cache_glyph(*this, glyphKey, atlasBytes) })).first->second.texture;
+		++iGlyphCacheStatistics.entries;
+		iGlyphCacheStatistics.atlasBytes += atlasBytes;
+
+		const std::size_t textureWidth = static_cast<std::size_t>(glyphRect.cx);
+		const std::size_t texturePixels = static_cast<std::size_t>(glyphRect.cx * glyphRect.cy);
 
 		const GLubyte* textureData = 0;
 		
 		if (useSubpixelFiltering)
 		{
-			// sub-pixel FIR filter.
-			static double coefficients[] = { 1.5 / 16.0, 3.0 / 16.0, 7.0 / 16.0, 3.0 / 16.0, 1.5 / 16.0 };
-			for (uint32_t y = 0; y < bitmap.rows; y++)
-			{
-				for (uint32_t x = 0; x < bitmap.width; x++)
-				{
-					uint8_t alpha = 0;
-					for (int32_t z = -2; z <= 2; ++z)
-						alpha += static_cast<uint8_t>(bitmap.buffer[std::max(0, std::min<int32_t>(bitmap.width - 1, x + z)) + bitmap.pitch * y] * coefficients[z + 2]);
-					iSubpixelGlyphTextureData[(x / 3 + 1) + (y + 1) * static_cast<std::size_t>(glyphRect.cx)][x % 3] = alpha;
-				}
-			}
+			iSubpixelGlyphTextureData.assign(texturePixels, std::array<GLubyte, 4>{});
 			textureData = &iSubpixelGlyphTextureData[0][0];
+			convert_glyph_bitmap(glyph_bitmap_format::Subpixel, bitmap.buffer, bitmap.width, bitmap.rows, bitmap.pitch, 
+				&iSubpixelGlyphTextureData[0][0] + (1 + textureWidth) * 4, textureWidth * 4);
 		}
 		else
 		{
-			for (uint32_t y = 0; y < bitmap.rows; y++)
-				switch (bitmap.pixel_mode)
-				{
-				case FT_PIXEL_MODE_MONO: // 1 bit per pixel monochrome
-					for (uint32_t x = 0; x < bitmap.width; x += 8)
-						for (uint32_t b = 0; b < std::min(bitmap.width, 8u); ++b)
-							iGlyphTextureData[(x + b + 1) + (y + 1) * static_cast<std::size_t>(glyphRect.cx)] =
-							(x >= bitmap.width || y >= bitmap.rows) ? 0x00 : ((bitmap.buffer[x / 8 + bitmap.pitch * y] & (1 << (7 - b))) != 0 ? 0xFF : 0x00);
-					break;
-				case FT_PIXEL_MODE_GRAY:
-				default:
-					for (uint32_t x = 0; x < bitmap.width; x++)
-						iGlyphTextureData[(x + 1) + (y + 1) * static_cast<std::size_t>(glyphRect.cx)] =
-						(x >= bitmap.width || y >= bitmap.rows) ? 0x00 : bitmap.buffer[x + bitmap.pitch * y];
-					break;
-				}
+			iGlyphTextureData.assign(texturePixels, 0x00);
 			textureData = &iGlyphTextureData[0];
+			convert_glyph_bitmap(bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? glyph_bitmap_format::Mono : glyph_bitmap_format::Grey, bitmap.buffer, bitmap.width, bitmap.rows, bitmap.pitch,
+				&iGlyphTextureData[0] + (1 + textureWidth), textureWidth);
 		}
 		GLint previousTexture;
 		glCheck(glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture));
@@ -345,6 +389,63 @@ namespace neogfx
 		return glyphTexture;
 	}
 
+	const glyph_cache_statistics& native_font_face::glyph_cache_statistics() const
+	{
+		return iGlyphCacheStatistics;
+	}
+
+	FT_Error native_font_face::get_advance(FT_UInt aGlyphIndex, FT_Int32 aLoadFlags, FT_Fixed& aAdvance) const
+	{
+		advance_table* table = nullptr;
+		for (auto& slot : iAdvanceTables)
+		{
+			table = slot.load(std::memory_order_acquire);
+			if (table == nullptr || table->load_flags() == aLoadFlags)
+				break;
+			table = nullptr;
+		}
+		if (table != nullptr)
+		{
+			auto const cachedAdvance = table->find(aGlyphIndex);
+			if (cachedAdvance != advance_table::NotCached)
+			{
+				aAdvance = cachedAdvance;
+				return FT_Err_Ok;
+			}
+		}
+		std::lock_guard<std::recursive_mutex> lock{ iFreeTypeMutex };
+		auto result = orig_FT_Get_Advance(iHandle, aGlyphIndex, aLoadFlags, &aAdvance);
+		if (result != FT_Err_Ok)
+			return result;
+		if (table == nullptr)
+		{
+			// slots are only ever filled whilst holding the FreeType mutex so a simple scan for a free slot suffices
+			for (auto& slot : iAdvanceTables)
+			{
+				auto existingTable = slot.load(std::memory_order_acquire);
+				if (existingTable != nullptr && existingTable->load_flags() == aLoadFlags)
+				{
+					table = existingTable;
+					break;
+				}
+				if (existingTable == nullptr)
+				{
+					table = new advance_table{ aLoadFlags, iHandle->num_glyphs };
+					slot.store(table, std::memory_order_release);
+					break;
+				}
+			}
+		}
+		if (table != nullptr)
+			table->insert(aGlyphIndex, aAdvance);
+		return result;
+	}
+
+	std::recursive_mutex& native_font_face::freetype_mutex() const
+	{
+		return iFreeTypeMutex;
+	}
+
 	void native_font_face::add_ref()
 	{
 		native_font().add_ref(*this);
@@ -355,6 +456,25 @@ namespace neogfx
 		native_font().release(*this);
 	}
 
+	font_manager& native_font_face::font_manager() const
+	{
+		return static_cast<neogfx::font_manager&>(iRenderingEngine.font_manager());
+	}
+
+	void native_font_face::evict_glyph(std::pair<uint32_t, bool> aGlyph) const
+	{
+		auto existingGlyph = iGlyphs.find(aGlyph);
+		if (existingGlyph == iGlyphs.end())
+			return;
+		auto& atlas = font_manager().glyph_atlas();
+		atlas.destroy_sub_texture(atlas.sub_texture(existingGlyph->second.texture.texture().atlas_id()));
+		--iGlyphCacheStatistics.entries;
+		iGlyphCacheStatistics.atlasBytes -= existingGlyph->second.cacheEntry->atlasBytes;
+		++iGlyphCacheStatistics.evictions;
+		font_manager().uncache_glyph(existingGlyph->second.cacheEntry);
+		iGlyphs.erase(existingGlyph);
+	}
+
 	void native_font_face::set_metrics()
 	{
 		if (!is_bitmap_font())
@@ -21,8 +21,10 @@
 
 #include <neogfx/neogfx.hpp>
 #include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include <boost/functional/hash.hpp>
-#include <boost/pool/pool_alloc.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #ifdef u8
@@ -40,6 +42,7 @@
 #include <neogfx/core/geometrical.hpp>
 #include <neogfx/hid/i_surface.hpp>
 #include <neogfx/gfx/text/font.hpp>
+#include <neogfx/gfx/text/font_manager.hpp>
 #include "glyph_texture.hpp"
 #include "i_native_font.hpp"
 #include "i_native_font_face.hpp"
@@ -71,10 +74,38 @@ namespace neogfx
 
 	class native_font_face : public i_native_font_face
 	{
+		friend class neogfx::font_manager;
 	private:
-		typedef std::unordered_map<std::pair<uint32_t, bool>, neogfx::glyph_texture, boost::hash<std::pair<uint32_t, bool>>> glyph_map;
-		typedef std::unordered_map<std::pair<uint32_t, uint32_t>, dimension, boost::hash<std::pair<uint32_t, uint32_t>>, std::equal_to<std::pair<uint32_t, uint32_t>>, 
-			boost::fast_pool_allocator<std::pair<const std::pair<uint32_t, uint32_t>, dimension>>> kerning_table;
+		struct cached_glyph
+		{
+			neogfx::glyph_texture texture;
+			neogfx::font_manager::glyph_cache_lru::iterator cacheEntry;
+		};
+		typedef std::unordered_map<std::pair<uint32_t, bool>, cached_glyph, boost::hash<std::pair<uint32_t, bool>>> glyph_map;
+		// Dense glyph advance table for one set of FreeType load flags; pages of advances are allocated on first use so
+		// only the glyph IDs actually used cost memory. Lookups are lock free and may be made from any thread.
+		class advance_table
+		{
+		public:
+			static constexpr FT_Fixed NotCached = std::numeric_limits<FT_Fixed>::min();
+			static constexpr uint32_t PageSize = 256u;
+		private:
+			typedef std::array<std::atomic<FT_Fixed>, PageSize> page;
+		public:
+			advance_table(FT_Int32 aLoadFlags, FT_Long aGlyphCount);
+			~advance_table();
+		public:
+			FT_Int32 load_flags() const;
+			FT_Fixed find(FT_UInt aGlyphIndex) const;
+			void insert(FT_UInt aGlyphIndex, FT_Fixed aAdvance);
+		private:
+			const FT_Int32 iLoadFlags;
+			const uint32_t iPageCount;
+			std::unique_ptr<std::atomic<page*>[]> iPages;
+		};
+		static constexpr std::size_t MaxAdvanceTables = 4u;
+		typedef std::array<std::atomic<advance_table*>, MaxAdvanceTables> advance_tables;
+		typedef std::unordered_map<uint64_t, float> kerning_table;
 	public:
 		struct hb_handle
 		{
@@ -124,11 +155,17 @@ namespace neogfx
 		void* aux_handle() const override;
 		uint32_t glyph_index(char32_t aCodePoint) const override;
 		i_glyph_texture& glyph_texture(const glyph& aGlyph) const override;
+		const neogfx::glyph_cache_statistics& glyph_cache_statistics() const override;
 	public:
 		void add_ref() override;
 		void release() override;
+	public:
+		FT_Error get_advance(FT_UInt aGlyphIndex, FT_Int32 aLoadFlags, FT_Fixed& aAdvance) const;
+		std::recursive_mutex& freetype_mutex() const;
 	private:
 		void set_metrics();
+		neogfx::font_manager& font_manager() const;
+		void evict_glyph(std::pair<uint32_t, bool> aGlyph) const;
 	private:
 		i_rendering_engine& iRenderingEngine;
 		i_native_font& iFont;
@@ -137,12 +174,16 @@ namespace neogfx
 		font::point_size iSize;
 		neogfx::size iPixelDensityDpi;
 		FT_Face iHandle;
+		mutable std::recursive_mutex iFreeTypeMutex;
 		mutable std::unique_ptr<hb_handle> iAuxHandle;
 		mutable std::unique_ptr<i_native_font_face> iFallbackFont;
 		mutable glyph_map iGlyphs;
+		mutable neogfx::glyph_cache_statistics iGlyphCacheStatistics;
 		mutable std::vector<GLubyte> iGlyphTextureData;
 		mutable std::vector<std::array<GLubyte, 4>> iSubpixelGlyphTextureData;
+		mutable advance_tables iAdvanceTables;
 		bool iHasKerning;
+		mutable std::shared_mutex iKerningTableMutex;
 		mutable kerning_table iKerningTable;
 		mutable std::optional<bool> iHasFallback;
 	};
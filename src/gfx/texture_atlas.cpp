@@ -68,7 +68,7 @@ namespace neogfx
 		auto iterEntry = iEntries.find(aSubTexture.atlas_id());
 		if (iterEntry == iEntries.end())
 			throw sub_texture_not_found();
-		auto rectEntry = iterEntry->second.second.atlas_location();
+		auto rectEntry = iterEntry->second.second.atlas_location() - point{ 1.0, 1.0 };
 		auto space = iterEntry->second.first->second.used.find(rectEntry);
 		if (space != iterEntry->second.first->second.used.end())
 			iterEntry->second.first->second.used.erase(space);
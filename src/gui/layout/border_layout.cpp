@@ -172,7 +172,6 @@ namespace neogfx
 
 	void border_layout::layout_items(const point& aPosition, const size& aSize)
 	{
-		next_layout_id();
 		validate();
 		iRows.layout_items(aPosition, aSize);
 	}
@@ -94,7 +94,6 @@ namespace neogfx
 			std::cerr << "flow_layout::layout_items(" << aPosition << ", " << aSize << ")" << std::endl;
 		if (has_layout_owner())
 			layout_owner().layout_items_started();
-		next_layout_id();
 		validate();
 		if (iFlowDirection == FlowDirectionHorizontal)
 			do_layout_items<layout::column_major<flow_layout>>(aPosition, aSize);
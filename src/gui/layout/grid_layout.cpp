@@ -26,6 +26,49 @@
 
 namespace neogfx
 {
+	namespace
+	{
+		template <typename Line, typename Coordinate>
+		void set_line_entry(Line& aLine, Coordinate aPosition, i_layout_item* aItem)
+		{
+			auto existing = std::lower_bound(aLine.begin(), aLine.end(), aPosition,
+				[](const typename Line::value_type& aEntry, Coordinate aValue) { return aEntry.first < aValue; });
+			if (existing != aLine.end() && existing->first == aPosition)
+			{
+				if (aItem != nullptr)
+					existing->second = aItem;
+				else
+					aLine.erase(existing);
+			}
+			else if (aItem != nullptr)
+				aLine.insert(existing, typename Line::value_type{ aPosition, aItem });
+		}
+
+		template <typename Metrics>
+		Metrics& line_metrics_for(std::vector<Metrics>& aMetrics, uint32_t aLine)
+		{
+			if (aLine >= aMetrics.size())
+				aMetrics.resize(aLine + 1);
+			auto& result = aMetrics[aLine];
+			if (result.generation != i_layout_item::generation())
+				result = Metrics{ i_layout_item::generation() };
+			return result;
+		}
+
+		template <typename Metrics>
+		Metrics& line_metrics_for(std::vector<Metrics>& aMetrics, uint32_t aLine, const optional_size& aAvailableSpace)
+		{
+			auto& result = line_metrics_for(aMetrics, aLine);
+			if (result.availableSpace != aAvailableSpace)
+			{
+				result.availableSpace = aAvailableSpace;
+				result.minimum = std::nullopt;
+				result.maximum = std::nullopt;
+			}
+			return result;
+		}
+	}
+
 	grid_layout::grid_layout(neogfx::alignment aAlignment) :
 		layout{ aAlignment }, neolib::lifetime{ neolib::lifetime_state::Creating }, iRowLayout{ *this, aAlignment }
 	{
@@ -85,6 +128,7 @@ namespace neogfx
 	void grid_layout::set_dimensions(cell_coordinate aRows, cell_coordinate aColumns)
 	{
 		iDimensions = cell_dimensions{aColumns, aRows};
+		dirty_all_lines();
 	}
 
 	bool grid_layout::is_item_at_position(cell_coordinate aRow, cell_coordinate aColumn) const
@@ -127,8 +171,13 @@ namespace neogfx
 				add_spacer_at_position(aRow, col);
 		auto& layout_item_proxy = layout::add(aItem).layout_item_proxy();
 		iCells[cell_coordinates{ aColumn, aRow }] = &layout_item_proxy;
-		iDimensions.cy = std::max(iDimensions.cy, aRow + 1);
-		iDimensions.cx = std::max(iDimensions.cx, aColumn + 1);
+		index_cell(cell_coordinates{ aColumn, aRow }, &layout_item_proxy);
+		if (aRow >= iDimensions.cy || aColumn >= iDimensions.cx)
+		{
+			iDimensions.cy = std::max(iDimensions.cy, aRow + 1);
+			iDimensions.cx = std::max(iDimensions.cx, aColumn + 1);
+			dirty_all_lines();
+		}
 		row_layout(aRow).replace_item_at(aColumn, layout_item_proxy);
 		if (cursor() == cell_coordinates{ aColumn, aRow })
 			increment_cursor();
@@ -209,18 +258,13 @@ namespace neogfx
 	{
 		if (!is_alive())
 			return;
+		dirty_all_lines();
 		layout::invalidate();
 		iRowLayout.invalidate();
 		for (auto& row : iRows)
 			row->invalidate();
 	}
 
-	void grid_layout::next_layout_id()
-	{
-		layout::next_layout_id();
-		iRowLayout.next_layout_id();
-	}
-
 	size grid_layout::minimum_size(const optional_size& aAvailableSpace) const
 	{
 		if (items_visible() == 0)
@@ -262,7 +306,9 @@ namespace neogfx
 		if (availableSpaceForChildren != std::nullopt)
 			*availableSpaceForChildren -= margins().size();
 		size result;
-		for (cell_coordinate row = 0; row < visible_rows(); ++row)
+		auto const visibleRows = visible_rows();
+		auto const visibleColumns = visible_columns();
+		for (cell_coordinate row = 0; row < visibleRows; ++row)
 		{
 			size::dimension_type rowMaxSize = row_maximum_size(row, availableSpaceForChildren);
 			if (rowMaxSize == size::max_dimension())
@@ -270,7 +316,7 @@ namespace neogfx
 			else if (result.cy != size::max_dimension())
 				result.cy += rowMaxSize;
 		}
-		for (cell_coordinate column = 0; column < visible_columns(); ++column)
+		for (cell_coordinate column = 0; column < visibleColumns; ++column)
 		{
 			size::dimension_type columnMaxSize = column_maximum_size(column, availableSpaceForChildren);
 			if (columnMaxSize == size::max_dimension())
@@ -282,10 +328,10 @@ namespace neogfx
 			result.cx += (margins().left + margins().right);
 		if (result.cy != size::max_dimension())
 			result.cy += (margins().top + margins().bottom);
-		if (result.cx != size::max_dimension() && visible_columns() > 0)
-			result.cx += (spacing().cx * (visible_columns() - 1));
-		if (result.cy != size::max_dimension() && visible_rows() > 0)
-			result.cy += (spacing().cy * (visible_rows() - 1));
+		if (result.cx != size::max_dimension() && visibleColumns > 0)
+			result.cx += (spacing().cx * (visibleColumns - 1));
+		if (result.cy != size::max_dimension() && visibleRows > 0)
+			result.cy += (spacing().cy * (visibleRows - 1));
 		if (result.cx != size::max_dimension())
 			result.cx = std::min(result.cx, layout::maximum_size(aAvailableSpace).cx);
 		if (result.cy != size::max_dimension())
@@ -312,6 +358,10 @@ namespace neogfx
 	grid_layout& grid_layout::add_span(const cell_coordinates& aFrom, const cell_coordinates& aTo)
 	{
 		iSpans.push_back(std::make_pair(aFrom, aTo));
+		for (cell_coordinate row = aFrom.y; row <= aTo.y; ++row)
+			for (cell_coordinate column = aFrom.x; column <= aTo.x; ++column)
+				iSpanIndex.emplace(cell_coordinates{ column, row }, iSpans.size() - 1);
+		dirty_lines(aFrom, aTo);
 		if (has_layout_owner())
 			layout_owner().layout_root(true);
 		return *this;
@@ -333,7 +383,6 @@ namespace neogfx
 			std::cerr << "grid_layout::layout_items(" << aPosition << ", " << aSize << ")" << std::endl;
 		if (has_layout_owner())
 			layout_owner().layout_items_started();
-		next_layout_id();
 		validate();
 		set_position(aPosition);
 		set_extents(aSize);
@@ -347,72 +396,56 @@ namespace neogfx
 		iRowLayout.layout_items(availablePos, availableSize);
 		std::vector<dimension> maxRowHeight(iDimensions.cy);
 		std::vector<dimension> maxColWidth(iDimensions.cx);
-		for (cell_coordinate row = 0; row < iDimensions.cy; ++row)
+		for (const auto& cell : iCells)
 		{
-			for (cell_coordinate col = 0; col < iDimensions.cx; ++col)
-			{
-				auto i = iCells.find(cell_coordinates{ col, row });
-				if (i != iCells.end())
-				{
-					auto s = find_span(cell_coordinates{ col, row });
-					if (s == iSpans.end() || s->first.y == s->second.y)
-						maxRowHeight[row] = std::max(maxRowHeight[row], i->second->extents().cy);
-					if (s == iSpans.end() || s->first.x == s->second.x)
-						maxColWidth[col] = std::max(maxColWidth[col], i->second->extents().cx);
-				}
-			}
+			auto const& pos = cell.first;
+			if (pos.x >= iDimensions.cx || pos.y >= iDimensions.cy)
+				continue;
+			auto s = find_span(pos);
+			if (s == iSpans.end() || s->first.y == s->second.y)
+				maxRowHeight[pos.y] = std::max(maxRowHeight[pos.y], cell.second->extents().cy);
+			if (s == iSpans.end() || s->first.x == s->second.x)
+				maxColWidth[pos.x] = std::max(maxColWidth[pos.x], cell.second->extents().cx);
 		}
-		point rowPos = availablePos;
+		// empty rows and columns take up no space (nor spacing) except when measuring spans
+		std::vector<coordinate> rowPos(iDimensions.cy);
+		std::vector<coordinate> spanRowPos(iDimensions.cy);
+		coordinate y = availablePos.y;
+		coordinate spanY = availablePos.y;
 		for (cell_coordinate row = 0; row < iDimensions.cy; ++row)
 		{
-			if (maxRowHeight[row] == 0.0)
+			rowPos[row] = y;
+			spanRowPos[row] = spanY;
+			if (maxRowHeight[row] != 0.0)
+				y += (maxRowHeight[row] + spacing().cy);
+			spanY += (maxRowHeight[row] + spacing().cy);
+		}
+		std::vector<coordinate> colPos(iDimensions.cx);
+		std::vector<coordinate> spanColPos(iDimensions.cx);
+		coordinate x = availablePos.x;
+		coordinate spanX = availablePos.x;
+		for (cell_coordinate col = 0; col < iDimensions.cx; ++col)
+		{
+			colPos[col] = x;
+			spanColPos[col] = spanX;
+			if (maxColWidth[col] != 0.0)
+				x += (maxColWidth[col] + spacing().cx);
+			spanX += (maxColWidth[col] + spacing().cx);
+		}
+		for (const auto& cell : iCells)
+		{
+			auto const& pos = cell.first;
+			if (pos.x >= iDimensions.cx || pos.y >= iDimensions.cy || maxRowHeight[pos.y] == 0.0 || maxColWidth[pos.x] == 0.0)
 				continue;
-			point colPos = rowPos;
-			for (cell_coordinate col = 0; col < iDimensions.cx; ++col)
+			auto s = find_span(pos);
+			if (s != iSpans.end() && s->second.x < iDimensions.cx && s->second.y < iDimensions.cy)
 			{
-				if (maxColWidth[col] == 0.0)
-					continue;
-				auto i = iCells.find(cell_coordinates{ col, row });
-				if (i != iCells.end())
-				{
-					bool foundSpan = false;
-					for (auto& s : iSpans)
-					{
-						if (col >= s.first.x && col <= s.second.x &&
-							row >= s.first.y && row <= s.second.y)
-						{
-							point fromPos;
-							point toPos;
-							point rowPos2 = availablePos;
-							for (cell_coordinate row2 = 0; !foundSpan && row2 <= s.second.y; ++row2)
-							{
-								point colPos2 = rowPos2;
-								for (cell_coordinate col2 = 0; !foundSpan && col2 <= s.second.x; ++col2)
-								{
-									if (row2 == s.first.y && col2 == s.first.x)
-										fromPos = colPos2;
-									if (row2 == s.second.y && col2 == s.second.x)
-									{
-										toPos = colPos2 + size{ maxColWidth[col2], maxRowHeight[row2] };
-										i->second->layout_as(fromPos, toPos - fromPos);
-										foundSpan = true;
-									}
-									colPos2.x += maxColWidth[col2];
-									colPos2.x += spacing().cx;
-								}
-								rowPos2.y += maxRowHeight[row2];
-								rowPos2.y += spacing().cy;
-							}
-						}
-					}
-					if (!foundSpan)
-						i->second->layout_as(colPos, size{maxColWidth[col], maxRowHeight[row]});
-				}
-				colPos.x += maxColWidth[col];
-				colPos.x += spacing().cx;
+				point fromPos{ spanColPos[s->first.x], spanRowPos[s->first.y] };
+				point toPos = point{ spanColPos[s->second.x], spanRowPos[s->second.y] } + size{ maxColWidth[s->second.x], maxRowHeight[s->second.y] };
+				cell.second->layout_as(fromPos, toPos - fromPos);
 			}
-			rowPos.y += maxRowHeight[row];
-			rowPos.y += spacing().cy;
+			else
+				cell.second->layout_as(point{ colPos[pos.x], rowPos[pos.y] }, size{ maxColWidth[pos.x], maxRowHeight[pos.y] });
 		}
 		if (has_layout_owner())
 			layout_owner().layout_items_completed();
@@ -430,6 +463,7 @@ namespace neogfx
 		row_layout(itemPos.y).remove_at(itemPos.x);
 		if (itemPos.x < row_layout(itemPos.y).count())
 			row_layout(itemPos.y).add_spacer_at(itemPos.x);
+		index_cell(itemPos, nullptr);
 		iCells.erase(iCells.find(itemPos));
 		iDimensions = cell_dimensions{};
 		for (const auto& cell : iCells)
@@ -437,6 +471,7 @@ namespace neogfx
 			iDimensions.cy = std::max(iDimensions.cy, cell.first.y);
 			iDimensions.cx = std::max(iDimensions.cx, cell.first.x);
 		}
+		dirty_all_lines();
 		iCursor = cell_coordinates{};
 		layout::remove(aItem);
 		if (count() == 0)
@@ -447,98 +482,122 @@ namespace neogfx
 	{
 		uint32_t result = 0;
 		for (cell_coordinate row = 0; row < iDimensions.cy; ++row)
-			for (cell_coordinate col = 0; col < iDimensions.cx; ++col)
-			{
-				auto i = iCells.find(cell_coordinates{col, row});
-				if (i != iCells.end() && i->second->visible() && i->second->minimum_size().cy != 0.0)
-				{
-					++result;
-					break;
-				}
-			}
+			if (is_row_visible(row))
+				++result;
 		return result;
 	}
 
 	bool grid_layout::is_row_visible(uint32_t aRow) const
 	{
-		for (cell_coordinate col = 0; col < iDimensions.cx; ++col)
+		if (aRow >= iRowCells.size())
+			return false;
+		auto& metrics = line_metrics_for(iRowMetrics, aRow);
+		if (metrics.visible == std::nullopt)
 		{
-			auto i = iCells.find(cell_coordinates{col, aRow});
-			if (i != iCells.end() && i->second->visible() && i->second->minimum_size().cy != 0.0)
-				return true;
+			metrics.visible = false;
+			for (const auto& cell : iRowCells[aRow])
+				if (cell.first < iDimensions.cx && cell.second->visible() && cell.second->minimum_size().cy != 0.0)
+				{
+					metrics.visible = true;
+					break;
+				}
 		}
-		return false;
+		return *metrics.visible;
 	}
 
 	uint32_t grid_layout::visible_columns() const
 	{
 		uint32_t result = 0;
 		for (cell_coordinate col = 0; col < iDimensions.cx; ++col)
-			for (cell_coordinate row = 0; row < iDimensions.cy; ++row)
-			{
-				auto i = iCells.find(cell_coordinates{col, row});
-				if (i != iCells.end() && i->second->visible() && i->second->minimum_size().cx != 0.0)
-				{
-					++result;
-					break;
-				}
-			}
+			if (is_column_visible(col))
+				++result;
 		return result;
 	}
 
 	bool grid_layout::is_column_visible(uint32_t aColumn) const
 	{
-		for (cell_coordinate row = 0; row < iDimensions.cy; ++row)
+		if (aColumn >= iColumnCells.size())
+			return false;
+		auto& metrics = line_metrics_for(iColumnMetrics, aColumn);
+		if (metrics.visible == std::nullopt)
 		{
-			auto i = iCells.find(cell_coordinates{aColumn, row});
-			if (i != iCells.end() && i->second->visible() && i->second->minimum_size().cx != 0.0)
-				return true;
+			metrics.visible = false;
+			for (const auto& cell : iColumnCells[aColumn])
+				if (cell.first < iDimensions.cy && cell.second->visible() && cell.second->minimum_size().cx != 0.0)
+				{
+					metrics.visible = true;
+					break;
+				}
 		}
-		return false;
+		return *metrics.visible;
 	}
 
 	size::dimension_type grid_layout::row_minimum_size(cell_coordinate aRow, const optional_size& aAvailableSpace) const
 	{
-		size::dimension_type result {};
-		for (const auto& item : iCells)
-			if (item.first.y == aRow)
+		if (aRow >= iRowCells.size())
+			return size::dimension_type{};
+		auto& metrics = line_metrics_for(iRowMetrics, aRow, aAvailableSpace);
+		if (metrics.minimum == std::nullopt)
+		{
+			size::dimension_type result {};
+			for (const auto& cell : iRowCells[aRow])
 			{
-				auto s = find_span(item.first);
+				auto s = find_span(cell_coordinates{ cell.first, aRow });
 				if (s == iSpans.end() || s->first.y == s->second.y)
-					result = std::max(result, item.second->minimum_size(aAvailableSpace).cy);
+					result = std::max(result, cell.second->minimum_size(aAvailableSpace).cy);
 			}
-		return std::ceil(result);
+			metrics.minimum = std::ceil(result);
+		}
+		return *metrics.minimum;
 	}
 
 	size::dimension_type grid_layout::column_minimum_size(cell_coordinate aColumn, const optional_size& aAvailableSpace) const
 	{
-		size::dimension_type result {};
-		for (const auto& item : iCells)
-			if (item.first.x == aColumn)
+		if (aColumn >= iColumnCells.size())
+			return size::dimension_type{};
+		auto& metrics = line_metrics_for(iColumnMetrics, aColumn, aAvailableSpace);
+		if (metrics.minimum == std::nullopt)
+		{
+			size::dimension_type result {};
+			for (const auto& cell : iColumnCells[aColumn])
 			{
-				auto s = find_span(item.first);
+				auto s = find_span(cell_coordinates{ aColumn, cell.first });
 				if (s == iSpans.end() || s->first.x == s->second.x)
-					result = std::max(result, item.second->minimum_size(aAvailableSpace).cx);
+					result = std::max(result, cell.second->minimum_size(aAvailableSpace).cx);
 			}
-		return std::ceil(result);
+			metrics.minimum = std::ceil(result);
+		}
+		return *metrics.minimum;
 	}
 
 	size::dimension_type grid_layout::row_maximum_size(cell_coordinate aRow, const optional_size& aAvailableSpace) const
 	{
-		size::dimension_type result {};
-		for (const auto& item : iCells)
-			if (item.first.y == aRow)
-				result = std::max(result, item.second->maximum_size(aAvailableSpace).cy);
-		return result;
+		if (aRow >= iRowCells.size())
+			return size::dimension_type{};
+		auto& metrics = line_metrics_for(iRowMetrics, aRow, aAvailableSpace);
+		if (metrics.maximum == std::nullopt)
+		{
+			size::dimension_type result {};
+			for (const auto& cell : iRowCells[aRow])
+				result = std::max(result, cell.second->maximum_size(aAvailableSpace).cy);
+			metrics.maximum = result;
+		}
+		return *metrics.maximum;
 	}
 
 	size::dimension_type grid_layout::column_maximum_size(cell_coordinate aColumn, const optional_size& aAvailableSpace) const
 	{
-		size::dimension_type result {};
-		for (const auto& item : iCells)
-			if (item.first.x == aColumn)
-				result = std::max(result, item.second->maximum_size(aAvailableSpace).cx);
-		return result;
+		if (aColumn >= iColumnCells.size())
+			return size::dimension_type{};
+		auto& metrics = line_metrics_for(iColumnMetrics, aColumn, aAvailableSpace);
+		if (metrics.maximum == std::nullopt)
+		{
+			size::dimension_type result {};
+			for (const auto& cell : iColumnCells[aColumn])
+				result = std::max(result, cell.second->maximum_size(aAvailableSpace).cx);
+			metrics.maximum = result;
+		}
+		return *metrics.maximum;
 	}
 
 	void grid_layout::increment_cursor()
@@ -572,12 +631,42 @@ namespace neogfx
 
 	grid_layout::span_list::const_iterator grid_layout::find_span(const cell_coordinates& aCell) const
 	{
-		for (auto s = iSpans.begin(); s != iSpans.end(); ++s)
-			if (aCell.x >= s->first.x && aCell.x <= s->second.x && aCell.y >= s->first.y && aCell.y <= s->second.y)
-				return s;
+		auto existing = iSpanIndex.find(aCell);
+		if (existing != iSpanIndex.end())
+			return iSpans.begin() + existing->second;
 		return iSpans.end();
 	}
 
+	void grid_layout::index_cell(const cell_coordinates& aCell, i_layout_item* aItem)
+	{
+		if (aItem != nullptr)
+		{
+			if (iRowCells.size() <= aCell.y)
+				iRowCells.resize(aCell.y + 1);
+			if (iColumnCells.size() <= aCell.x)
+				iColumnCells.resize(aCell.x + 1);
+		}
+		if (aCell.y < iRowCells.size())
+			set_line_entry(iRowCells[aCell.y], aCell.x, aItem);
+		if (aCell.x < iColumnCells.size())
+			set_line_entry(iColumnCells[aCell.x], aCell.y, aItem);
+		dirty_lines(aCell, aCell);
+	}
+
+	void grid_layout::dirty_lines(const cell_coordinates& aFrom, const cell_coordinates& aTo)
+	{
+		for (auto row = aFrom.y; row <= aTo.y && row < iRowMetrics.size(); ++row)
+			iRowMetrics[row].generation = 0u;
+		for (auto column = aFrom.x; column <= aTo.x && column < iColumnMetrics.size(); ++column)
+			iColumnMetrics[column].generation = 0u;
+	}
+
+	void grid_layout::dirty_all_lines()
+	{
+		iRowMetrics.clear();
+		iColumnMetrics.clear();
+	}
+
 	void grid_layout::init()
 	{
 		iRowLayout.set_margins(neogfx::margins{});
@@ -46,8 +46,8 @@ namespace neogfx
 		iEnabled{ false },
 		iMinimumSize{},
 		iMaximumSize{},
+		iItemIndexValid{ true },
 		iLayoutStarted{ false },
-		iLayoutId{ 0 },
 		iInvalidated{ false }
 	{
 		enable();
@@ -62,8 +62,8 @@ namespace neogfx
 		iEnabled{ false },
 		iMinimumSize{},
 		iMaximumSize{},
+		iItemIndexValid{ true },
 		iLayoutStarted{ false },
-		iLayoutId{ 0 },
 		iInvalidated{ false }
 	{
 		aOwner.set_layout(*this);
@@ -80,8 +80,8 @@ namespace neogfx
 		iEnabled{ false },
 		iMinimumSize{},
 		iMaximumSize{},
+		iItemIndexValid{ true },
 		iLayoutStarted{ false },
-		iLayoutId{ 0 },
 		iInvalidated{ false }
 	{
 		aParent.add(*this);
@@ -217,7 +217,11 @@ namespace neogfx
 		}
 		while (aPosition > iItems.size())
 			add_spacer_at(0);
-		auto i = iItems.insert(std::next(iItems.begin(), aPosition), item{ aItem });
+		auto i = iItems.insert(iItems.begin() + aPosition, new item{ aItem });
+		if (aPosition == iItems.size() - 1 && iItemIndexValid)
+			index_item(aPosition);
+		else
+			invalidate_item_index();
 		i->set_parent_layout(this);
 		if (has_layout_owner())
 			i->set_layout_owner(&layout_owner());
@@ -225,19 +229,62 @@ namespace neogfx
 		return *aItem;
 	}
 
+	void layout::add_items(const std::vector<std::shared_ptr<i_layout_item>>& aItems)
+	{
+		bool const wasEnabled = enabled();
+		disable();
+		iItems.reserve(iItems.size() + aItems.size());
+		try
+		{
+			for (auto& item : aItems)
+				add(item);
+		}
+		catch (...)
+		{
+			if (wasEnabled)
+				enable();
+			throw;
+		}
+		if (wasEnabled)
+			enable();
+	}
+
 	void layout::remove_at(item_index aIndex)
 	{
-		remove(std::next(iItems.begin(), aIndex));
+		if (aIndex >= iItems.size())
+			throw bad_item_index();
+		remove(iItems.begin() + aIndex);
+	}
+
+	void layout::remove_items_at(item_index aFirst, item_index aLast)
+	{
+		if (aFirst > aLast || aLast > iItems.size())
+			throw bad_item_index();
+		bool const wasEnabled = enabled();
+		disable();
+		try
+		{
+			for (auto i = aLast; i > aFirst && i - 1 < iItems.size(); --i)
+				remove(iItems.begin() + (i - 1));
+		}
+		catch (...)
+		{
+			if (wasEnabled)
+				enable();
+			throw;
+		}
+		if (wasEnabled)
+			enable();
 	}
 
 	bool layout::remove(i_layout_item& aItem)
 	{
-		for (auto i = begin(); i != end(); ++i)
-			if (&i->subject() == &aItem)
-			{
-				remove(i);
-				return true;
-			}
+		auto existing = find_index(aItem);
+		if (existing != std::nullopt && &iItems[*existing].subject() == &aItem)
+		{
+			remove(iItems.begin() + *existing);
+			return true;
+		}
 		for (auto i = rbegin(); i != rend(); ++i)
 			if (i->subject().is_layout() && i->subject().as_layout().remove(aItem))
 				return true;
@@ -246,9 +293,14 @@ namespace neogfx
 
 	void layout::remove_all()
 	{
+		bool const wasEnabled = enabled();
+		disable();
 		while (!iItems.empty())
 			remove(std::prev(iItems.end()));
-		invalidate();
+		if (wasEnabled)
+			enable();
+		else
+			invalidate();
 	}
 
 	void layout::move_all_to(i_layout& aDestination)
@@ -256,7 +308,9 @@ namespace neogfx
 		try
 		{
 			auto& compatibleDestination = dynamic_cast<layout&>(aDestination); // dynamic_cast? not a fan but heh.
-			compatibleDestination.iItems.splice(compatibleDestination.items().end(), iItems);
+			compatibleDestination.iItems.transfer(compatibleDestination.iItems.end(), iItems);
+			invalidate_item_index();
+			compatibleDestination.invalidate_item_index();
 			for (auto& item : compatibleDestination)
 				item.set_parent_layout(&compatibleDestination);
 		}
@@ -275,12 +329,9 @@ namespace neogfx
 
 	layout::optional_item_index layout::find(const i_layout_item& aItem) const
 	{
-		for (auto i = iItems.begin(); i != iItems.end(); ++i)
-		{
-			const auto& item = *i;
-			if (&item.subject() == &aItem)
-				return std::distance(iItems.begin(), i);
-		}
+		auto existing = find_index(aItem);
+		if (existing != std::nullopt && &iItems[*existing].subject() == &aItem)
+			return existing;
 		return optional_item_index();
 	}
 
@@ -288,16 +339,14 @@ namespace neogfx
 	{
 		if (aIndex >= iItems.size())
 			throw bad_item_index();
-		auto item = std::next(iItems.begin(), aIndex);
-		return item->is_widget();
+		return iItems[aIndex].is_widget();
 	}
 
 	const i_layout_item& layout::item_at(item_index aIndex) const
 	{
 		if (aIndex >= iItems.size())
 			throw bad_item_index();
-		auto item = std::next(iItems.begin(), aIndex);
-		return item->subject();
+		return iItems[aIndex].subject();
 	}
 
 	i_layout_item& layout::item_at(item_index aIndex)
@@ -309,9 +358,9 @@ namespace neogfx
 	{
 		if (aIndex >= iItems.size())
 			throw bad_item_index();
-		auto item = std::next(iItems.begin(), aIndex);
-		if (item->subject().is_widget())
-			return item->subject().as_widget();
+		auto& item = iItems[aIndex];
+		if (item.subject().is_widget())
+			return item.subject().as_widget();
 		throw not_a_widget();
 	}
 
@@ -324,9 +373,9 @@ namespace neogfx
 	{
 		if (aIndex >= iItems.size())
 			throw bad_item_index();
-		auto item = std::next(iItems.begin(), aIndex);
-		if (item->subject().is_layout())
-			return item->subject().as_layout();
+		auto& item = iItems[aIndex];
+		if (item.subject().is_layout())
+			return item.subject().as_layout();
 		throw not_a_layout();
 	}
 
@@ -337,9 +386,9 @@ namespace neogfx
 
 	const i_layout_item_proxy& layout::find_proxy(const i_layout_item& aItem) const
 	{
-		for (auto& item : items())
-			if (&item == &aItem || &item.subject() == &aItem)
-				return item;
+		auto existing = find_index(aItem);
+		if (existing != std::nullopt)
+			return iItems[*existing];
 		throw item_not_found();
 	}
 
@@ -459,22 +508,6 @@ namespace neogfx
 		layout_items(aPosition, aSize);
 	}
 
-	uint32_t layout::layout_id() const
-	{
-		return iLayoutId;
-	}
-
-	void layout::next_layout_id()
-	{
-		if (++iLayoutId == static_cast<uint32_t>(-1))
-			iLayoutId = 0;
-		for (auto& item : *this)
-			if (item.is_layout())
-				item.as_layout().next_layout_id();
-			else if (item.is_widget() && item.as_widget().has_layout())
-				item.as_widget().layout().next_layout_id();
-	}
-
 	bool layout::visible() const
 	{
 		return true;
@@ -492,6 +525,8 @@ namespace neogfx
 		if (invalidated())
 			return;
 		iInvalidated = true;
+		for (auto& item : iItems)
+			item.invalidate_size_hints();
 		if (has_parent_layout())
 			parent_layout().invalidate();
 		if (has_layout_owner())
@@ -713,17 +748,17 @@ namespace neogfx
 
 	layout::item_list::const_iterator layout::find_item(const i_layout_item& aItem) const
 	{
-		for (auto i = iItems.begin(); i != iItems.end(); ++i)
-			if (&*i == &aItem || &i->subject() == &aItem)
-				return i;
+		auto existing = find_index(aItem);
+		if (existing != std::nullopt)
+			return iItems.begin() + *existing;
 		return iItems.end();
 	}
 
 	layout::item_list::iterator layout::find_item(i_layout_item& aItem)
 	{
-		for (auto i = iItems.begin(); i != iItems.end(); ++i)
-			if (&*i == &aItem || &i->subject() == &aItem)
-				return i;
+		auto existing = find_index(aItem);
+		if (existing != std::nullopt)
+			return iItems.begin() + *existing;
 		return iItems.end();
 	}
 
@@ -744,12 +779,19 @@ namespace neogfx
 	void layout::remove(item_list::iterator aItem)
 	{
 		{
-			item_list toRemove;
-			toRemove.splice(toRemove.begin(), iItems, aItem);
-			if (aItem->has_parent_layout() && &aItem->parent_layout() == this)
+			auto const index = static_cast<item_index>(aItem - iItems.begin());
+			if (index == iItems.size() - 1 && iItemIndexValid)
+			{
+				iItemIndex.erase(&*aItem);
+				iItemIndex.erase(&aItem->subject());
+			}
+			else
+				invalidate_item_index();
+			auto toRemove = iItems.release(aItem);
+			if (toRemove->has_parent_layout() && &toRemove->parent_layout() == this)
 			{
-				aItem->set_parent_layout(nullptr);
-				aItem->set_layout_owner(nullptr);
+				toRemove->set_parent_layout(nullptr);
+				toRemove->set_layout_owner(nullptr);
 			}
 		}
 		invalidate();
@@ -770,4 +812,36 @@ namespace neogfx
 			}
 		return count;
 	}
+
+	layout::optional_item_index layout::find_index(const i_layout_item& aItem) const
+	{
+		if (!iItemIndexValid)
+		{
+			iItemIndex.clear();
+			iItemIndex.reserve(iItems.size() * 2);
+			for (item_index index = 0; index < iItems.size(); ++index)
+				index_item(index);
+			iItemIndexValid = true;
+		}
+		auto existing = iItemIndex.find(&aItem);
+		if (existing != iItemIndex.end())
+			return existing->second;
+		return optional_item_index();
+	}
+
+	void layout::index_item(item_index aIndex) const
+	{
+		auto& item = iItems[aIndex];
+		iItemIndex[&item] = aIndex;
+		iItemIndex.emplace(&item.subject(), aIndex);
+	}
+
+	void layout::invalidate_item_index()
+	{
+		if (iItemIndexValid)
+		{
+			iItemIndex.clear();
+			iItemIndexValid = false;
+		}
+	}
 }
\ No newline at end of file
@@ -252,21 +252,22 @@ namespace neogfx
 		uint32_t itemsUsingLeftover = 0;
 		size totalExpanderWeight;
 		enum disposition_e { Unknown, Weighted, Unweighted, TooSmall, FixedSize };
-		std::unordered_map<const item*, disposition_e, std::hash<const item*>, std::equal_to<const item*>, neolib::fast_pool_allocator<std::pair<const item* const, disposition_e>>> itemDispositions;
-		for (const auto& item : items())
+		std::vector<disposition_e> itemDispositions(items().size(), Unknown);
+		for (item_index itemIndex = 0; itemIndex < items().size(); ++itemIndex)
 		{
+			const auto& item = items()[itemIndex];
 			if (!item.visible())
 				continue;
 			if (AxisPolicy::size_policy_x(item.size_policy()) == neogfx::size_policy::Minimum)
 			{
-				itemDispositions[&item] = TooSmall;
+				itemDispositions[itemIndex] = TooSmall;
 				leftover -= AxisPolicy::cx(item.minimum_size(availableSize));
 				if (leftover < 0.0)
 					leftover = 0.0;
 			}
 			else if (AxisPolicy::size_policy_x(item.size_policy()) == neogfx::size_policy::Fixed)
 			{
-				itemDispositions[&item] = FixedSize;
+				itemDispositions[itemIndex] = FixedSize;
 				leftover -= AxisPolicy::cx(item.minimum_size(availableSize));
 				if (leftover < 0.0)
 					leftover = 0.0;
@@ -281,11 +282,12 @@ namespace neogfx
 		while (!done && itemsUsingLeftover > 0)
 		{
 			done = true;
-			for (const auto& item : items())
+			for (item_index itemIndex = 0; itemIndex < items().size(); ++itemIndex)
 			{
+				const auto& item = items()[itemIndex];
 				if (!item.visible())
 					continue;
-				auto& disposition = itemDispositions[&item];
+				auto& disposition = itemDispositions[itemIndex];
 				if (disposition != Unknown && disposition != Weighted)
 					continue;
 				auto minSize = AxisPolicy::cx(item.minimum_size(availableSize));
@@ -315,9 +317,9 @@ namespace neogfx
 		}
 		size::dimension_type weightedAmount = 0.0;
 		if (AxisPolicy::cx(totalExpanderWeight) > 0.0)
-			for (const auto& item : items())
-				if (item.visible() && itemDispositions[&item] == Weighted)
-					weightedAmount += weighted_size<AxisPolicy>(item, totalExpanderWeight, leftover, availableSize);
+			for (item_index itemIndex = 0; itemIndex < items().size(); ++itemIndex)
+				if (items()[itemIndex].visible() && itemDispositions[itemIndex] == Weighted)
+					weightedAmount += weighted_size<AxisPolicy>(items()[itemIndex], totalExpanderWeight, leftover, availableSize);
 		uint32_t bitsLeft = 0;
 		if (itemsUsingLeftover > 0)
 			bitsLeft = static_cast<int32_t>(leftover - weightedAmount);
@@ -326,15 +328,16 @@ namespace neogfx
 		point nextPos = aPosition;
 		nextPos.x += margins().left;
 		nextPos.y += margins().top;
-		for (auto& item : *this)
+		for (item_index itemIndex = 0; itemIndex < iItems.size(); ++itemIndex)
 		{
+			auto& item = iItems[itemIndex];
 			if (!item.visible())
 				continue;
 			auto itemMinSize = item.minimum_size(availableSize);
 			auto itemMaxSize = item.maximum_size(availableSize);
 			size s;
 			AxisPolicy::cy(s) = std::min(std::max(AxisPolicy::cy(itemMinSize), AxisPolicy::cy(availableSize)), AxisPolicy::cy(itemMaxSize));
-			auto disposition = itemDispositions[&item];
+			auto disposition = itemDispositions[itemIndex];
 			if (disposition == FixedSize)
 				AxisPolicy::cx(s) = AxisPolicy::cx(itemMinSize);
 			else if (disposition == TooSmall)
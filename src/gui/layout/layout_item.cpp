@@ -24,18 +24,50 @@
 
 namespace neogfx
 {
+	namespace
+	{
+		// Size hints are valid for one generation; the generation advances at the start of every
+		// outermost layout pass so that each item is measured at most once per available space per
+		// pass. Changes made between passes discard only the hints of the items they affect.
+		i_layout_item::generation_type sGeneration = 1u;
+		uint32_t sLayoutPassDepth;
+	}
+
+	i_layout_item::generation_type i_layout_item::generation()
+	{
+		return sGeneration;
+	}
+
+	void i_layout_item::next_generation()
+	{
+		if (++sGeneration == 0u)
+			sGeneration = 1u;
+	}
+
+	void i_layout_item::layout_pass_started()
+	{
+		if (sLayoutPassDepth++ == 0u)
+			next_generation();
+	}
+
+	void i_layout_item::layout_pass_completed()
+	{
+		if (sLayoutPassDepth != 0u)
+			--sLayoutPassDepth;
+	}
+
 	layout_item::layout_item(i_layout_item& aItem) :
 		layout_item{ std::shared_ptr<i_layout_item>{ std::shared_ptr<i_layout_item>{}, &aItem } } 
 	{
 	}
 
 	layout_item::layout_item(std::shared_ptr<i_layout_item> aItem) :
-		iSubject{ aItem }, iLayoutId{ -1, -1 }
+		iSubject{ aItem }, iMinimumSize{}, iMaximumSize{}, iNextMinimumSize{ 0u }, iNextMaximumSize{ 0u }
 	{
 	}
 
 	layout_item::layout_item(const layout_item& aOther) :
-		iSubject{ aOther.iSubject }, iLayoutId{ -1, -1 }
+		iSubject{ aOther.iSubject }, iMinimumSize{}, iMaximumSize{}, iNextMinimumSize{ 0u }, iNextMaximumSize{ 0u }
 	{
 	}
 
@@ -269,39 +301,35 @@ namespace neogfx
 	{
 		if (!visible())
 			return size{};
-		if (iLayoutId.first == parent_layout().layout_id() && iLayoutId.first != -1)
-			return iMinimumSize;
-		else
+		auto cached = find_size_hint(iMinimumSize, aAvailableSpace);
+		if (cached != nullptr)
+			return cached->value;
+		size result = subject().minimum_size(aAvailableSpace);
+		if (size_policy().maintain_aspect_ratio())
 		{
-			iMinimumSize = subject().minimum_size(aAvailableSpace);
-			if (size_policy().maintain_aspect_ratio())
+			const auto& aspectRatio = size_policy().aspect_ratio();
+			if (aspectRatio.cx < aspectRatio.cy)
 			{
-				const auto& aspectRatio = size_policy().aspect_ratio();
-				if (aspectRatio.cx < aspectRatio.cy)
-				{
-					if (iMinimumSize.cx < iMinimumSize.cy)
-						iMinimumSize = size{ iMinimumSize.cx, iMinimumSize.cx * (aspectRatio.cy / aspectRatio.cx) };
-					else
-						iMinimumSize = size{ iMinimumSize.cy * (aspectRatio.cx / aspectRatio.cy), iMinimumSize.cy };
-				}
+				if (result.cx < result.cy)
+					result = size{ result.cx, result.cx * (aspectRatio.cy / aspectRatio.cx) };
 				else
-				{
-					if (iMinimumSize.cx < iMinimumSize.cy)
-						iMinimumSize = size{ iMinimumSize.cy * (aspectRatio.cx / aspectRatio.cy), iMinimumSize.cy };
-					else
-						iMinimumSize = size{ iMinimumSize.cx, iMinimumSize.cx * (aspectRatio.cy / aspectRatio.cx) };
-				}
+					result = size{ result.cy * (aspectRatio.cx / aspectRatio.cy), result.cy };
+			}
+			else
+			{
+				if (result.cx < result.cy)
+					result = size{ result.cy * (aspectRatio.cx / aspectRatio.cy), result.cy };
+				else
+					result = size{ result.cx, result.cx * (aspectRatio.cy / aspectRatio.cx) };
 			}
-			iLayoutId.first = parent_layout().layout_id();
-			return iMinimumSize;
 		}
+		return cache_size_hint(iMinimumSize, iNextMinimumSize, aAvailableSpace, result);
 	}
 
 	void layout_item::set_minimum_size(const optional_size& aMinimumSize, bool aUpdateLayout)
 	{
 		subject().set_minimum_size(aMinimumSize, aUpdateLayout);
-		if (aMinimumSize != std::nullopt)
-			iMinimumSize = *aMinimumSize;
+		invalidate_size_hints();
 	}
 
 	bool layout_item::has_maximum_size() const
@@ -313,21 +341,16 @@ namespace neogfx
 	{
 		if (!visible())
 			return size::max_size();
-		if (iLayoutId.second == parent_layout().layout_id() && iLayoutId.second != -1)
-			return iMaximumSize;
-		else
-		{
-			iMaximumSize = subject().maximum_size(aAvailableSpace);
-			iLayoutId.second = parent_layout().layout_id();
-			return iMaximumSize;
-		}
+		auto cached = find_size_hint(iMaximumSize, aAvailableSpace);
+		if (cached != nullptr)
+			return cached->value;
+		return cache_size_hint(iMaximumSize, iNextMaximumSize, aAvailableSpace, subject().maximum_size(aAvailableSpace));
 	}
 
 	void layout_item::set_maximum_size(const optional_size& aMaximumSize, bool aUpdateLayout)
 	{
 		subject().set_maximum_size(aMaximumSize, aUpdateLayout);
-		if (aMaximumSize != std::nullopt)
-			iMaximumSize = *aMaximumSize;
+		invalidate_size_hints();
 	}
 
 	bool layout_item::has_margins() const
@@ -350,8 +373,34 @@ namespace neogfx
 		return subject().visible();
 	}
 
+	void layout_item::invalidate_size_hints()
+	{
+		for (auto& entry : iMinimumSize)
+			entry.generation = 0u;
+		for (auto& entry : iMaximumSize)
+			entry.generation = 0u;
+	}
+
 	bool layout_item::operator==(const layout_item& aOther) const
 	{
 		return iSubject == aOther.iSubject;
 	}
+
+	const layout_item::size_hint* layout_item::find_size_hint(const size_hint_cache& aCache, const optional_size& aAvailableSpace)
+	{
+		for (const auto& entry : aCache)
+			if (entry.generation == generation() && entry.availableSpace == aAvailableSpace)
+				return &entry;
+		return nullptr;
+	}
+
+	const size& layout_item::cache_size_hint(size_hint_cache& aCache, uint32_t& aNextEntry, const optional_size& aAvailableSpace, const size& aValue)
+	{
+		auto& entry = aCache[aNextEntry];
+		aNextEntry = (aNextEntry + 1u) % aCache.size();
+		entry.generation = generation();
+		entry.availableSpace = aAvailableSpace;
+		entry.value = aValue;
+		return entry.value;
+	}
 }
@@ -0,0 +1,170 @@
+// layout_scheduler.cpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+#include <unordered_set>
+#include <neolib/lifetime.hpp>
+#include <neogfx/app/app.hpp>
+#include <neogfx/gui/layout/layout_scheduler.hpp>
+#include <neogfx/gui/widget/i_widget.hpp>
+#include <neogfx/gui/window/i_window.hpp>
+
+namespace neogfx
+{
+	layout_scheduler::layout_scheduler()
+	{
+	}
+
+	layout_scheduler::~layout_scheduler()
+	{
+	}
+
+	layout_scheduler& layout_scheduler::instance()
+	{
+		static layout_scheduler sInstance;
+		return sInstance;
+	}
+
+	void layout_scheduler::schedule(i_widget& aWidget)
+	{
+		if (!aWidget.has_root())
+			return;
+		auto& window = aWidget.root();
+		const i_widget* const key = &window.as_widget();
+		++iStatistics[key].requests;
+		auto existing = iScheduled.find(&aWidget);
+		if (existing != iScheduled.end())
+		{
+			if (existing->second == key)
+			{
+				++iStatistics[key].coalesced;
+				return;
+			}
+			cancel(aWidget);
+		}
+		auto& queue = iQueues[key];
+		queue.dirty.push_back(&aWidget);
+		iScheduled[&aWidget] = key;
+		if (queue.timer == nullptr)
+		{
+			queue.pause = std::make_unique<pause_rendering>(window);
+			queue.timer = std::make_unique<neolib::callback_timer>(app::instance(), [this, &window](neolib::callback_timer&)
+			{
+				run(window);
+			}, 0);
+		}
+	}
+
+	void layout_scheduler::cancel(const i_widget& aWidget)
+	{
+		auto existing = iScheduled.find(&aWidget);
+		if (existing != iScheduled.end())
+		{
+			auto queue = iQueues.find(existing->second);
+			iScheduled.erase(existing);
+			if (queue != iQueues.end())
+			{
+				auto& dirty = queue->second.dirty;
+				dirty.erase(std::remove(dirty.begin(), dirty.end(), &aWidget), dirty.end());
+			}
+		}
+	}
+
+	void layout_scheduler::remove(const i_widget& aWidget)
+	{
+		cancel(aWidget);
+		auto ownQueue = iQueues.find(&aWidget);
+		if (ownQueue != iQueues.end())
+		{
+			for (auto w : ownQueue->second.dirty)
+				iScheduled.erase(w);
+			iQueues.erase(ownQueue);
+		}
+		iStatistics.erase(&aWidget);
+	}
+
+	bool layout_scheduler::is_scheduled(const i_widget& aWidget) const
+	{
+		return iScheduled.find(&aWidget) != iScheduled.end();
+	}
+
+	void layout_scheduler::run(i_window& aWindow)
+	{
+		auto existingQueue = iQueues.find(&aWindow.as_widget());
+		if (existingQueue == iQueues.end())
+			return;
+		// keep rendering paused (and the timer alive) until the pass has completed
+		window_queue queue = std::move(existingQueue->second);
+		iQueues.erase(existingQueue);
+		for (auto w : queue.dirty)
+			iScheduled.erase(w);
+		if (!aWindow.has_native_window())
+			return;
+		std::unordered_set<const i_widget*> dirty{ queue.dirty.begin(), queue.dirty.end() };
+		std::vector<std::pair<uint32_t, i_widget*>> roots;
+		for (auto w : queue.dirty)
+		{
+			uint32_t depth = 0;
+			bool nested = false;
+			for (const i_widget* p = w; p->has_parent(); ++depth)
+			{
+				p = &p->parent();
+				if (dirty.find(p) != dirty.end())
+				{
+					nested = true;
+					break;
+				}
+			}
+			if (!nested)
+				roots.emplace_back(depth, w);
+		}
+		std::stable_sort(roots.begin(), roots.end(), [](const std::pair<uint32_t, i_widget*>& aLhs, const std::pair<uint32_t, i_widget*>& aRhs) { return aLhs.first < aRhs.first; });
+		{
+			auto& stats = iStatistics[&aWindow.as_widget()];
+			stats.coalesced += queue.dirty.size() - roots.size();
+			stats.passes += roots.size();
+			stats.lastFramePasses = static_cast<uint32_t>(roots.size());
+			++stats.frames;
+		}
+		neolib::destroyed_flag windowDestroyed{ aWindow.as_widget().as_lifetime() };
+		// laying out one root can destroy another
+		std::vector<std::unique_ptr<neolib::destroyed_flag>> rootsDestroyed;
+		rootsDestroyed.reserve(roots.size());
+		for (auto& root : roots)
+			rootsDestroyed.push_back(std::make_unique<neolib::destroyed_flag>(root.second->as_lifetime()));
+		for (std::size_t i = 0; i < roots.size(); ++i)
+		{
+			if (*rootsDestroyed[i])
+				continue;
+			roots[i].second->layout_items();
+			if (windowDestroyed)
+				return;
+			if (!*rootsDestroyed[i])
+				roots[i].second->update();
+		}
+	}
+
+	layout_scheduler::statistics layout_scheduler::stats(const i_window& aWindow) const
+	{
+		auto existing = iStatistics.find(&aWindow.as_widget());
+		if (existing != iStatistics.end())
+			return existing->second;
+		return statistics{};
+	}
+}
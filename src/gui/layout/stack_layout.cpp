@@ -101,7 +101,6 @@ namespace neogfx
 			std::cerr << "stack_layout::layout_items(" << aPosition << ", " << aSize << ")" << std::endl;
 		if (has_layout_owner())
 			layout_owner().layout_items_started();
-		next_layout_id();
 		validate();
 		for (auto& item : *this)
 		{
@@ -80,7 +80,6 @@ namespace neogfx
 			std::cerr << "vertical_layout::layout_items(" << aPosition << ", " << aSize << ")" << std::endl;
 		if (has_layout_owner())
 			layout_owner().layout_items_started();
-		next_layout_id();
 		validate();
 		layout::do_layout_items<layout::row_major<vertical_layout>>(aPosition, aSize);
 		if (has_layout_owner())
@@ -18,9 +18,9 @@
 */
 
 #include <neogfx/neogfx.hpp>
-#include <neolib/timer.hpp>
 #include <neolib/lifetime.hpp>
 #include <neogfx/app/app.hpp>
+#include <neogfx/app/animation_clock.hpp>
 #include <neogfx/gui/layout/i_layout.hpp>
 #include <neogfx/gui/widget/header_view.hpp>
 #include <neogfx/gui/widget/push_button.hpp>
@@ -28,11 +28,11 @@
 
 namespace neogfx
 {
-	class header_view::updater : private neolib::callback_timer
+	class header_view::updater : public neolib::lifetime
 	{
 	public:
 		updater(header_view& aParent) :
-			neolib::callback_timer{ app::instance(), [this, &aParent](neolib::callback_timer&)
+			iAnimation{ [this, &aParent]()
 			{
 				neolib::destroyed_flag destroyed{ *this };
 				neolib::destroyed_flag surfaceDestroyed{ aParent.surface().as_lifetime() };
@@ -59,17 +59,20 @@ namespace neogfx
 					}
 				}
 				if (iRow == aParent.presentation_model().rows())
+				{
+					iAnimation.stop();
 					aParent.iOwner.header_view_updated(aParent, header_view_update_reason::FullUpdate);
-				else
-					again();
-			}, 10 },
+				}
+			} },
 			iRow{ 0 }
 		{
+			iAnimation.start();
 		}
 		~updater()
 		{
-			cancel();
+			iAnimation.stop();
 		}
+		animation iAnimation;
 		uint32_t iRow;
 	};
 
@@ -262,7 +262,7 @@ namespace neogfx
 
 	void item_view::released()
 	{
-		iMouseTracker = std::nullopt;
+		iMouseTracker.stop();
 	}
 
 	neogfx::focus_policy item_view::focus_policy() const
@@ -304,15 +304,7 @@ namespace neogfx
 					edit(*item);
 			}			
 			if (capturing())
-			{
-				iMouseTracker.emplace(app::instance(), [this](neolib::callback_timer& aTimer)
-				{
-					aTimer.again();
-					auto item = item_at(root().mouse_position() - origin());
-					if (item != std::nullopt)
-						selection_model().set_current_index(*item);
-				}, 20);
-			}
+				iMouseTracker.start();
 		}
 	}
 
@@ -535,6 +527,11 @@ namespace neogfx
 		}
 	}
 
+	rect item_view::scrolled_content_rect() const
+	{
+		return item_display_rect();
+	}
+
 	void item_view::column_info_changed(const i_item_model&, item_model_index::value_type)
 	{
 		update_scrollbar_visibility();
@@ -985,4 +982,11 @@ namespace neogfx
 				make_visible(selection_model().current_index());
 		});
 	}
+
+	void item_view::track_mouse()
+	{
+		auto item = item_at(root().mouse_position() - origin());
+		if (item != std::nullopt)
+			selection_model().set_current_index(*item);
+	}
 }
\ No newline at end of file
@@ -46,7 +46,7 @@ namespace neogfx
 	menu_item_widget::~menu_item_widget()
 	{
 		app::instance().remove_mnemonic(*this);
-		iSubMenuOpener.reset();
+		iSubMenuOpener.stop();
 	}
 
 	i_menu& menu_item_widget::menu() const
@@ -74,6 +74,11 @@ namespace neogfx
 		return result;
 	}
 
+	bool menu_item_widget::opaque() const
+	{
+		return false;
+	}
+
 	void menu_item_widget::paint_non_client(graphics_context& aGraphicsContext) const
 	{
 		if (menu().has_selected_item() && menu().selected_item() == (menu().find(menu_item())))
@@ -199,7 +204,7 @@ namespace neogfx
 		widget::mouse_left();
 		update();
 		if (menu().has_selected_item() && menu().selected_item() == (menu().find(menu_item())) &&
-			(menu_item().type() == i_menu_item::Action || (!menu_item().sub_menu().is_open() && !iSubMenuOpener)))
+			(menu_item().type() == i_menu_item::Action || (!menu_item().sub_menu().is_open() && !iSubMenuOpener.running())))
 			menu().clear_selection();
 	}
 
@@ -374,17 +379,10 @@ namespace neogfx
 				app::instance().help().activate(*this);
 			else if (menu_item().type() == i_menu_item::SubMenu && menu_item().open_any_sub_menu() && menu().type() == i_menu::Popup)
 			{
-				if (!iSubMenuOpener)
+				if (!iSubMenuOpener.running())
 				{
-					iSubMenuOpener = std::make_unique<neolib::callback_timer>(app::instance(), [this](neolib::callback_timer&)
-					{
-						destroyed_flag destroyed{ *this };
-						if (!menu_item().sub_menu().is_open())
-							menu().open_sub_menu.trigger(menu_item().sub_menu());
-						if (!destroyed)
-							update();
-						iSubMenuOpener.reset();
-					}, 250);
+					iSubMenuOpenerStartTime = app::instance().program_elapsed_ms();
+					iSubMenuOpener.start();
 				}
 			}
 		});
@@ -392,7 +390,7 @@ namespace neogfx
 		{
 			if (menu_item().type() == i_menu_item::Action)
 				app::instance().help().deactivate(*this);
-			iSubMenuOpener.reset();
+			iSubMenuOpener.stop();
 		});
 	}
 
@@ -450,4 +448,16 @@ namespace neogfx
 			}
 		}
 	}
+
+	void menu_item_widget::delayed_open_sub_menu()
+	{
+		if (app::instance().program_elapsed_ms() - iSubMenuOpenerStartTime < 250u)
+			return;
+		iSubMenuOpener.stop();
+		destroyed_flag destroyed{ *this };
+		if (!menu_item().sub_menu().is_open())
+			menu().open_sub_menu.trigger(menu_item().sub_menu());
+		if (!destroyed)
+			update();
+	}
 }
\ No newline at end of file
@@ -26,7 +26,7 @@ namespace neogfx
 {
 	push_button::push_button(push_button_style aStyle) :
 		button{ (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -35,7 +35,7 @@ namespace neogfx
 
 	push_button::push_button(const std::string& aText, push_button_style aStyle) :
 		button{ aText, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -44,7 +44,7 @@ namespace neogfx
 
 	push_button::push_button(const i_texture& aTexture, push_button_style aStyle) :
 		button{ aTexture, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -53,7 +53,7 @@ namespace neogfx
 
 	push_button::push_button(const i_image& aImage, push_button_style aStyle) :
 		button{ aImage, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -62,7 +62,7 @@ namespace neogfx
 	
 	push_button::push_button(i_widget& aParent, push_button_style aStyle) :
 		button{ aParent, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -71,7 +71,7 @@ namespace neogfx
 
 	push_button::push_button(i_widget& aParent, const std::string& aText, push_button_style aStyle) :
 		button{ aParent, aText, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -80,7 +80,7 @@ namespace neogfx
 
 	push_button::push_button(i_widget& aParent, const i_texture& aTexture, push_button_style aStyle) :
 		button{ aParent, aTexture, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -89,7 +89,7 @@ namespace neogfx
 
 	push_button::push_button(i_widget& aParent, const i_image& aImage, push_button_style aStyle) :
 		button{ aParent, aImage, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -98,7 +98,7 @@ namespace neogfx
 
 	push_button::push_button(i_layout& aLayout, push_button_style aStyle) :
 		button{ aLayout, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -107,7 +107,7 @@ namespace neogfx
 
 	push_button::push_button(i_layout& aLayout, const std::string& aText, push_button_style aStyle) :
 		button{ aLayout, aText, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -116,7 +116,7 @@ namespace neogfx
 
 	push_button::push_button(i_layout& aLayout, const i_texture& aTexture, push_button_style aStyle) :
 		button{ aLayout, aTexture, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -125,7 +125,7 @@ namespace neogfx
 
 	push_button::push_button(i_layout& aLayout, const i_image& aImage, push_button_style aStyle) :
 		button{ aLayout, aImage, (aStyle == push_button_style::Normal || aStyle == push_button_style::ButtonBox || aStyle == push_button_style::SpinBox ? alignment::Centre : alignment::Left) | alignment::VCentre },
-		iAnimator{ app::instance(), [this](neolib::callback_timer&) { animate(); }, 20, false },
+		iAnimator{ [this]() { animate(); } },
 		iAnimationFrame{ 0 },
 		iStyle{ aStyle }
 	{
@@ -261,7 +261,7 @@ namespace neogfx
 	{
 		button::mouse_entered(aPosition);
 		if (perform_hover_animation() || !finished_animation())
-			iAnimator.again_if();
+			iAnimator.start();
 		update();
 	}
 
@@ -269,7 +269,7 @@ namespace neogfx
 	{
 		button::mouse_left();
 		if (perform_hover_animation() || !finished_animation())
-			iAnimator.again_if();
+			iAnimator.start();
 		update();
 	}
 
@@ -359,23 +359,24 @@ namespace neogfx
 	void push_button::animate()
 	{
 		if (!root().has_native_surface())
+		{
+			iAnimator.stop();
 			return;
+		}
 
 		if (entered() && enabled())
 		{
 			if (iAnimationFrame < kMaxAnimationFrame)
-			{
 				++iAnimationFrame;
-				iAnimator.again();
-			}
+			if (iAnimationFrame == kMaxAnimationFrame)
+				iAnimator.stop();
 		}
 		else
 		{
 			if (iAnimationFrame > 0)
-			{
 				--iAnimationFrame;
-				iAnimator.again();
-			}
+			if (iAnimationFrame == 0)
+				iAnimator.stop();
 		}
 		update();
 	}
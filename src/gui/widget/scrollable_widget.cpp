@@ -22,6 +22,7 @@
 #include <neogfx/app/app.hpp>
 #include <neogfx/gui/layout/i_layout.hpp>
 #include <neogfx/gui/widget/scrollable_widget.hpp>
+#include <neogfx/gui/window/window.hpp>
 
 namespace neogfx
 {
@@ -332,6 +333,57 @@ namespace neogfx
 		return iHorizontalScrollbar;
 	}
 
+	rect scrollable_widget::scrolled_content_rect() const
+	{
+		return client_rect(false);
+	}
+
+	bool scrollable_widget::scroll_by_copy(const point& aDelta)
+	{
+		// shift what is already on the surface instead of repainting it; only possible if the scrolled
+		// content is opaque, moves by whole pixels, has no child widgets over it and nothing else is
+		// drawn over it (including a window overlay)
+		if (aDelta.x != std::round(aDelta.x) || aDelta.y != std::round(aDelta.y))
+			return false;
+		if (!opaque() || root().is_nested() || !surface().has_native_surface())
+			return false;
+		auto rootWindow = dynamic_cast<const window*>(&root());
+		if (rootWindow == nullptr || rootWindow->paint_overlay.has_subscribers())
+			return false;
+		for (auto s : { &vertical_scrollbar(), &horizontal_scrollbar() })
+			if (s->visible() && (s->style() == scrollbar_style::Menu || s->style() == scrollbar_style::Scroller))
+				return false;
+		rect visibleArea = to_window_coordinates(client_rect());
+		for (const i_widget* w = this; !w->is_root(); w = &w->parent())
+			visibleArea = visibleArea.intersection(w->parent().to_window_coordinates(w->parent().client_rect()));
+		const rect scrolledArea = visibleArea.intersection(to_window_coordinates(scrolled_content_rect()));
+		if (scrolledArea.empty() || std::abs(aDelta.x) >= scrolledArea.cx || std::abs(aDelta.y) >= scrolledArea.cy)
+			return false;
+		for (const i_widget* w = this; !w->is_root(); w = &w->parent())
+			for (auto& sibling : w->parent().children())
+			{
+				if (&*sibling == w)
+					break;
+				if (!sibling->effectively_hidden() && !sibling->non_client_rect().intersection(scrolledArea).empty())
+					return false;
+			}
+		for (auto& c : children())
+		{
+			if (c->effectively_hidden())
+				continue;
+			point childDelta = aDelta;
+			if ((scrolling_disposition(*c) & neogfx::scrolling_disposition::ScrollChildWidgetVertically) == neogfx::scrolling_disposition::DontScrollChildWidget)
+				childDelta.y = 0.0;
+			if ((scrolling_disposition(*c) & neogfx::scrolling_disposition::ScrollChildWidgetHorizontally) == neogfx::scrolling_disposition::DontScrollChildWidget)
+				childDelta.x = 0.0;
+			const rect before = c->non_client_rect().intersection(scrolledArea);
+			const rect after = (c->non_client_rect() + childDelta).intersection(scrolledArea);
+			if (!before.empty() || !after.empty())
+				return false;
+		}
+		return surface().scroll_surface(scrolledArea, aDelta);
+	}
+
 	void scrollable_widget::init_scrollbars()
 	{
 		scoped_units su(static_cast<scrollable_widget&>(*this), units::Centimetres);
@@ -374,11 +426,18 @@ namespace neogfx
 
 	void scrollable_widget::scrollbar_updated(const i_scrollbar& aScrollbar, i_scrollbar::update_reason_e)
 	{
+		bool copied = false;
 		if (!iIgnoreScrollbarUpdates)
 		{
 			point scrollPosition = units_converter(*this).from_device_units(point(static_cast<coordinate>(horizontal_scrollbar().position()), static_cast<coordinate>(vertical_scrollbar().position())));
 			if (iOldScrollPosition != scrollPosition)
 			{
+				point contentDelta = -(scrollPosition - iOldScrollPosition);
+				if (aScrollbar.type() == scrollbar_type::Horizontal)
+					contentDelta.y = 0.0;
+				else
+					contentDelta.x = 0.0;
+				copied = scroll_by_copy(contentDelta);
 				for (auto& c : children())
 				{
 					point delta = -(scrollPosition - iOldScrollPosition);
@@ -398,7 +457,10 @@ namespace neogfx
 				}
 			}
 		}
-		update(true);
+		if (copied)
+			update(to_client_coordinates(scrollbar_geometry(*this, aScrollbar)));
+		else
+			update(true);
 	}
 
 	colour scrollable_widget::scrollbar_colour(const i_scrollbar&) const
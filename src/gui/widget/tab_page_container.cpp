@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <neogfx/neogfx.hpp>
 #include <neogfx/gui/widget/tab_page_container.hpp>
+#include <neogfx/app/app.hpp>
 
 namespace neogfx
 {
@@ -123,21 +124,24 @@ namespace neogfx
 	}
 
 	tab_page_container::tab_page_container(bool aClosableTabs, tab_container_style aStyle) :
-		widget{}, iContainerLayout{ *this }, iTabBar{ iContainerLayout.top(), *this, aClosableTabs, aStyle }
+		widget{}, iContainerLayout{ *this }, iTabBar{ iContainerLayout.top(), *this, aClosableTabs, aStyle },
+		iLazyTabPagePolicy{ neogfx::lazy_tab_page_policy::Retain }, iRetainedLazyTabPages{ 0u }, iLazyTabPageSelections{ 0u }
 	{
 		set_margins(neogfx::margins{});
 		update_tab_bar_placement();
 	}
 
 	tab_page_container::tab_page_container(i_widget& aParent, bool aClosableTabs, tab_container_style aStyle) :
-		widget{ aParent }, iContainerLayout{ *this }, iTabBar{ iContainerLayout.top(), *this, aClosableTabs, aStyle }
+		widget{ aParent }, iContainerLayout{ *this }, iTabBar{ iContainerLayout.top(), *this, aClosableTabs, aStyle },
+		iLazyTabPagePolicy{ neogfx::lazy_tab_page_policy::Retain }, iRetainedLazyTabPages{ 0u }, iLazyTabPageSelections{ 0u }
 	{
 		set_margins(neogfx::margins{});
 		update_tab_bar_placement();
 	}
 
 	tab_page_container::tab_page_container(i_layout& aLayout, bool aClosableTabs, tab_container_style aStyle) :
-		widget{ aLayout }, iContainerLayout{ *this }, iTabBar{ iContainerLayout.top(), *this, aClosableTabs, aStyle }
+		widget{ aLayout }, iContainerLayout{ *this }, iTabBar{ iContainerLayout.top(), *this, aClosableTabs, aStyle },
+		iLazyTabPagePolicy{ neogfx::lazy_tab_page_policy::Retain }, iRetainedLazyTabPages{ 0u }, iLazyTabPageSelections{ 0u }
 	{
 		set_margins(neogfx::margins{});
 		update_tab_bar_placement();
@@ -213,6 +217,8 @@ namespace neogfx
 
 	i_tab_page& tab_page_container::tab_page(tab_index aTabIndex)
 	{
+		if (aTabIndex < iTabs.size())
+			create_lazy_tab_page(tab(aTabIndex));
 		return const_cast<i_tab_page&>(const_cast<const tab_page_container*>(this)->tab_page(aTabIndex));
 	}
 
@@ -251,6 +257,8 @@ namespace neogfx
 
 	i_tab_page& tab_page_container::selected_tab_page()
 	{
+		if (is_tab_selected())
+			create_lazy_tab_page(selected_tab());
 		return const_cast<i_tab_page&>(const_cast<const tab_page_container*>(this)->selected_tab_page());
 	}
 
@@ -276,15 +284,17 @@ namespace neogfx
 	void tab_page_container::show_tab(tab_index aTabIndex)
 	{
 		tab(aTabIndex).as_widget().show();
-		if (has_tab_page(aTabIndex))
-			tab_page(aTabIndex).as_widget().show();
+		auto& tabPage = iTabs.find(&tab(aTabIndex))->second;
+		if (tabPage != nullptr)
+			tabPage->as_widget().show();
 	}
 
 	void tab_page_container::hide_tab(tab_index aTabIndex)
 	{
 		tab(aTabIndex).as_widget().hide();
-		if (has_tab_page(aTabIndex))
-			tab_page(aTabIndex).as_widget().hide();
+		auto& tabPage = iTabs.find(&tab(aTabIndex))->second;
+		if (tabPage != nullptr)
+			tabPage->as_widget().hide();
 	}
 
 	tab_page_container::optional_tab_index tab_page_container::next_visible_tab(tab_index aStartFrom) const
@@ -322,6 +332,7 @@ namespace neogfx
 		auto existingTab = iTabs.find(&aTab);
 		if (existingTab == iTabs.end())
 			throw tab_not_found();
+		iLazyTabPages.erase(&aTab);
 		existingTab->second = tab_page_pointer(new default_tab_page(page_layout(), aTab));
 		if (aTab.is_selected())
 		{
@@ -338,6 +349,7 @@ namespace neogfx
 		auto existingTab = iTabs.find(&aTab);
 		if (existingTab == iTabs.end())
 			throw tab_not_found();
+		iLazyTabPages.erase(&aTab);
 		existingTab->second = tab_page_pointer(tab_page_pointer(), &aWidget);
 		if (aTab.is_selected())
 		{
@@ -354,6 +366,7 @@ namespace neogfx
 		auto existingTab = iTabs.find(&aTab);
 		if (existingTab == iTabs.end())
 			throw tab_not_found();
+		iLazyTabPages.erase(&aTab);
 		existingTab->second = aWidget;
 		if (aTab.is_selected())
 		{
@@ -365,6 +378,33 @@ namespace neogfx
 		return *existingTab->second;
 	}
 
+	i_tab& tab_page_container::add_lazy_tab_page(const std::string& aTabText, tab_page_factory aFactory)
+	{
+		auto& newTab = add_tab(aTabText);
+		make_lazy(newTab, aFactory);
+		return newTab;
+	}
+
+	i_tab& tab_page_container::insert_lazy_tab_page(tab_index aTabIndex, const std::string& aTabText, tab_page_factory aFactory)
+	{
+		auto& newTab = insert_tab(aTabIndex, aTabText);
+		make_lazy(newTab, aFactory);
+		return newTab;
+	}
+
+	neogfx::lazy_tab_page_policy tab_page_container::lazy_tab_page_policy() const
+	{
+		return iLazyTabPagePolicy;
+	}
+
+	void tab_page_container::set_lazy_tab_page_policy(neogfx::lazy_tab_page_policy aPolicy, uint32_t aRetainedPages)
+	{
+		iLazyTabPagePolicy = aPolicy;
+		iRetainedLazyTabPages = aRetainedPages;
+		if (is_tab_selected())
+			reclaim_lazy_tab_pages(selected_tab());
+	}
+
 	void tab_page_container::adding_tab(i_tab& aTab)
 	{
 		iTabs.emplace(&aTab, tab_page_pointer());
@@ -374,6 +414,19 @@ namespace neogfx
 
 	void tab_page_container::selecting_tab(i_tab& aTab)
 	{
+		auto lazyTabPage = iLazyTabPages.find(&aTab);
+		if (lazyTabPage != iLazyTabPages.end())
+		{
+			lazyTabPage->second.lastSelected = ++iLazyTabPageSelections;
+			auto& tabPage = iTabs.find(&aTab)->second;
+			if (tabPage == nullptr)
+				create_lazy_tab_page(aTab);
+			else if (lazyTabPage->second.hibernating)
+			{
+				lazyTabPage->second.hibernating = false;
+				tabPage->waking.trigger();
+			}
+		}
 		for (auto& tab : iTabs)
 			if (tab.second != nullptr)
 			{
@@ -383,6 +436,14 @@ namespace neogfx
 					tab.second->as_widget().hide();
 			}
 		iContainerLayout.invalidate();
+		// pages are reclaimed from the event loop rather than from within the tab selection which
+		// may have been made by a widget on one of the pages being reclaimed
+		if (iLazyTabPagePolicy != neogfx::lazy_tab_page_policy::Retain)
+			iReclaimer = std::make_unique<neolib::callback_timer>(app::instance(), [this](neolib::callback_timer&)
+			{
+				if (is_tab_selected())
+					reclaim_lazy_tab_pages(selected_tab());
+			}, 0);
 	}
 
 	void tab_page_container::removing_tab(i_tab& aTab)
@@ -391,6 +452,7 @@ namespace neogfx
 		if (existingTab == iTabs.end())
 			throw tab_not_found();
 		iTabs.erase(existingTab);
+		iLazyTabPages.erase(&aTab);
 	}
 
 	bool tab_page_container::has_parent_container() const
@@ -450,4 +512,51 @@ namespace neogfx
 			break;
 		}
 	}
+
+	void tab_page_container::make_lazy(i_tab& aTab, tab_page_factory aFactory)
+	{
+		iLazyTabPages[&aTab] = lazy_tab_page{ aFactory, 0u, false };
+		// the first tab added is selected before its factory is known
+		if (aTab.is_selected())
+			selecting_tab(aTab);
+	}
+
+	void tab_page_container::create_lazy_tab_page(i_tab& aTab)
+	{
+		auto existingTab = iTabs.find(&aTab);
+		auto lazyTabPage = iLazyTabPages.find(&aTab);
+		if (existingTab == iTabs.end() || lazyTabPage == iLazyTabPages.end() || existingTab->second != nullptr)
+			return;
+		existingTab->second = lazyTabPage->second.factory(page_layout(), aTab);
+		lazyTabPage->second.hibernating = false;
+		if (existingTab->second != nullptr && !aTab.is_selected())
+			existingTab->second->as_widget().hide();
+	}
+
+	void tab_page_container::reclaim_lazy_tab_pages(const i_tab& aSelectedTab)
+	{
+		if (iLazyTabPagePolicy == neogfx::lazy_tab_page_policy::Retain)
+			return;
+		std::vector<lazy_tab_page_list::iterator> livePages;
+		for (auto lazyTabPage = iLazyTabPages.begin(); lazyTabPage != iLazyTabPages.end(); ++lazyTabPage)
+			if (lazyTabPage->first != &aSelectedTab && !lazyTabPage->second.hibernating && iTabs.find(lazyTabPage->first)->second != nullptr)
+				livePages.push_back(lazyTabPage);
+		if (livePages.size() <= iRetainedLazyTabPages)
+			return;
+		std::sort(livePages.begin(), livePages.end(), [](lazy_tab_page_list::iterator aLeft, lazy_tab_page_list::iterator aRight)
+		{
+			return aLeft->second.lastSelected > aRight->second.lastSelected;
+		});
+		for (auto lazyTabPage = livePages.begin() + iRetainedLazyTabPages; lazyTabPage != livePages.end(); ++lazyTabPage)
+		{
+			auto& tabPage = iTabs.find((*lazyTabPage)->first)->second;
+			if (iLazyTabPagePolicy == neogfx::lazy_tab_page_policy::Destroy)
+				tabPage.reset();
+			else
+			{
+				(*lazyTabPage)->second.hibernating = true;
+				tabPage->hibernating.trigger();
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -18,8 +18,16 @@
 */
 
 #include <neogfx/neogfx.hpp>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <boost/lexical_cast.hpp>
 #include <neolib/raii.hpp>
 #include <neogfx/gui/widget/text_edit.hpp>
+#include <neogfx/core/html.hpp>
 #include <neogfx/gfx/text/text_category_map.hpp>
 #include <neogfx/app/app.hpp>
 
@@ -148,6 +156,7 @@ namespace neogfx
 		{
 			if (--iOwner.iSuppressTextChangedNotification == 0u)
 			{
+				iOwner.iUndoGroupStarted = false;
 				bool notify = (iOwner.iWantedToNotfiyTextChanged > 0u);
 				iOwner.iWantedToNotfiyTextChanged = 0u;
 				if (notify)
@@ -158,11 +167,580 @@ namespace neogfx
 		text_edit & iOwner;
 	};
 
+	namespace
+	{
+		/* the threads text_edit shapes independent paragraphs on (see graphics_context::shape_text); the thread that runs a
+		   batch takes part in it as participant 0. The pool is shared by every text_edit and text loader so if it is busy with
+		   another batch the caller shapes its batch itself rather than wait. */
+		class paragraph_shaping_pool
+		{
+		public:
+			typedef std::function<void(std::size_t aParticipant, std::size_t aIndex)> task;
+		public:
+			static paragraph_shaping_pool& instance()
+			{
+				static paragraph_shaping_pool sInstance;
+				return sInstance;
+			}
+		private:
+			paragraph_shaping_pool() :
+				iStopping{ false }, iBatch{ 0u }, iTask{ nullptr }, iCount{ 0u }, iNext{ 0u }, iBusy{ 0u }
+			{
+				auto const threads = std::max(std::thread::hardware_concurrency(), 2u) - 1u;
+				for (std::size_t participant = 1u; participant <= threads; ++participant)
+					iThreads.emplace_back([this, participant]() { work(participant); });
+			}
+			~paragraph_shaping_pool()
+			{
+				{
+					std::lock_guard<std::mutex> lock{ iMutex };
+					iStopping = true;
+				}
+				iWorkReady.notify_all();
+				for (auto& thread : iThreads)
+					thread.join();
+			}
+		public:
+			std::size_t participants() const
+			{
+				return iThreads.size() + 1u;
+			}
+			void run(std::size_t aCount, const task& aTask)
+			{
+				std::unique_lock<std::mutex> batchLock{ iBatchMutex, std::try_to_lock };
+				if (!batchLock.owns_lock())
+				{
+					for (std::size_t index = 0u; index < aCount; ++index)
+						aTask(0u, index);
+					return;
+				}
+				{
+					std::lock_guard<std::mutex> lock{ iMutex };
+					iTask = &aTask;
+					iCount = aCount;
+					iNext = 0u;
+					iError = nullptr;
+					iBusy = iThreads.size();
+					++iBatch;
+				}
+				iWorkReady.notify_all();
+				take(0u);
+				std::exception_ptr error;
+				{
+					std::unique_lock<std::mutex> lock{ iMutex };
+					iWorkDone.wait(lock, [this]() { return iBusy == 0u; });
+					iTask = nullptr;
+					std::swap(error, iError);
+				}
+				if (error)
+					std::rethrow_exception(error);
+			}
+		private:
+			void work(std::size_t aParticipant)
+			{
+				uint64_t batch = 0u;
+				for (;;)
+				{
+					{
+						std::unique_lock<std::mutex> lock{ iMutex };
+						iWorkReady.wait(lock, [this, batch]() { return iStopping || iBatch != batch; });
+						if (iStopping)
+							return;
+						batch = iBatch;
+					}
+					take(aParticipant);
+					{
+						std::lock_guard<std::mutex> lock{ iMutex };
+						--iBusy;
+					}
+					iWorkDone.notify_one();
+				}
+			}
+			void take(std::size_t aParticipant)
+			{
+				for (auto index = iNext++; index < iCount; index = iNext++)
+				{
+					try
+					{
+						(*iTask)(aParticipant, index);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock{ iMutex };
+						if (!iError)
+							iError = std::current_exception();
+						iNext = iCount;
+					}
+				}
+			}
+		private:
+			std::vector<std::thread> iThreads;
+			std::mutex iBatchMutex;
+			std::mutex iMutex;
+			std::condition_variable iWorkReady;
+			std::condition_variable iWorkDone;
+			bool iStopping;
+			uint64_t iBatch;
+			const task* iTask;
+			std::size_t iCount;
+			std::atomic<std::size_t> iNext;
+			std::size_t iBusy;
+			std::exception_ptr iError;
+		};
+
+		// fallback fonts are created on first use so they are created here, on the UI thread, before shaping with aFont elsewhere
+		void create_fallback_fonts(const font& aFont)
+		{
+			for (auto fallbackFont = aFont; fallbackFont.has_fallback();)
+				fallbackFont = fallbackFont.fallback();
+		}
+	}
+
+	class text_edit::text_loader
+	{
+	public:
+		static constexpr std::size_t ChunkSize = 64 * 1024;
+		static constexpr uint32_t MaxChunksInFlight = 4u;
+	public:
+		text_loader(text_edit& aOwner, std::unique_ptr<std::istream> aStream) :
+			iOwner{ aOwner }, iOwnerThread{ std::this_thread::get_id() }, iStream{ std::move(aStream) }, iFont{ aOwner.loaded_text_font() }, iCancelled{ false }, iChunksInFlight{ 0u }
+		{
+			if (iFont != std::nullopt)
+			{
+				// loaded text is shaped on the loader thread (and the paragraph shaping pool) so fallback fonts are created up front
+				for (std::size_t participant = 0u; participant < paragraph_shaping_pool::instance().participants(); ++participant)
+					iGraphicsContexts.push_back(std::make_unique<graphics_context>(aOwner, graphics_context::type::Unattached));
+				create_fallback_fonts(*iFont);
+			}
+		}
+		~text_loader()
+		{
+			{
+				std::lock_guard<std::mutex> lock{ iMutex };
+				iCancelled = true;
+			}
+			iChunkConsumed.notify_one();
+			if (iThread.joinable())
+				iThread.join();
+		}
+	public:
+		void start(const std::shared_ptr<text_loader>& aSelf)
+		{
+			iSelf = aSelf;
+			iThread = std::thread{ [this]() { load(); } };
+		}
+	private:
+		void load()
+		{
+			std::vector<char> buffer(ChunkSize);
+			std::string pending;
+			while (!iCancelled && *iStream)
+			{
+				iStream->read(&buffer[0], buffer.size());
+				auto const count = static_cast<std::size_t>(iStream->gcount());
+				if (count == 0)
+					break;
+				pending.append(&buffer[0], count);
+				// chunks end on a paragraph boundary where possible so appending one never reshapes a paragraph already loaded;
+				// failing that don't split a UTF-8 sequence across chunks
+				auto complete = pending.rfind('\n');
+				if (complete != std::string::npos)
+					++complete;
+				else
+				{
+					complete = pending.size();
+					for (std::size_t back = 1; back <= 3 && back <= pending.size(); ++back)
+					{
+						auto const ch = static_cast<uint8_t>(pending[pending.size() - back]);
+						if ((ch & 0xC0) != 0x80)
+						{
+							auto const sequenceLength = (ch & 0xE0) == 0xC0 ? 2u : (ch & 0xF0) == 0xE0 ? 3u : (ch & 0xF8) == 0xF0 ? 4u : 1u;
+							if (sequenceLength > back)
+								complete = pending.size() - back;
+							break;
+						}
+					}
+				}
+				post_chunk(pending.substr(0, complete));
+				pending.erase(0, complete);
+			}
+			if (!pending.empty())
+				post_chunk(pending);
+			post([](text_edit& aOwner) { aOwner.text_loaded(); });
+		}
+		void post_chunk(const std::string& aChunk)
+		{
+			auto text = neolib::utf8_to_utf32(aChunk);
+			text.erase(std::remove(text.begin(), text.end(), U'\r'), text.end());
+			// paragraphs that can't be shaped here (those containing emoji) are left empty and shaped on the UI thread
+			auto paragraphs = std::make_shared<std::vector<glyph_text::container>>();
+			if (iFont != std::nullopt)
+			{
+				auto const& shapingFont = *iFont;
+				auto const fontSelector = [&shapingFont](std::u32string::size_type) { return shapingFont; };
+				std::vector<std::pair<std::u32string::const_iterator, std::u32string::const_iterator>> ranges;
+				for (auto paragraphStart = text.cbegin(); paragraphStart != text.cend();)
+				{
+					auto paragraphEnd = std::find(paragraphStart, text.cend(), U'\n');
+					if (paragraphEnd != text.cend())
+						++paragraphEnd;
+					ranges.emplace_back(paragraphStart, paragraphEnd);
+					paragraphStart = paragraphEnd;
+				}
+				paragraphs->resize(ranges.size());
+				paragraph_shaping_pool::instance().run(ranges.size(), [&](std::size_t aParticipant, std::size_t aIndex)
+				{
+					if (!iCancelled && !iGraphicsContexts[aParticipant]->shape_text(ranges[aIndex].first, ranges[aIndex].second, fontSelector, (*paragraphs)[aIndex]))
+						(*paragraphs)[aIndex].clear();
+				});
+			}
+			{
+				std::unique_lock<std::mutex> lock{ iMutex };
+				iChunkConsumed.wait(lock, [this]() { return iCancelled || iChunksInFlight < MaxChunksInFlight; });
+				if (iCancelled)
+					return;
+				++iChunksInFlight;
+			}
+			auto const shapingFont = iFont;
+			post([text, shapingFont, paragraphs](text_edit& aOwner) { aOwner.append_loaded_text(text, shapingFont, *paragraphs); }, true);
+		}
+		void post(std::function<void(text_edit&)> aWork, bool aChunk = false)
+		{
+			std::weak_ptr<text_loader> self = iSelf;
+			async_event_queue::instance().enqueue_to_thread(iOwnerThread, [self, aWork, aChunk]()
+			{
+				auto loader = self.lock();
+				if (loader == nullptr)
+					return;
+				if (aChunk)
+				{
+					{
+						std::lock_guard<std::mutex> lock{ loader->iMutex };
+						--loader->iChunksInFlight;
+					}
+					loader->iChunkConsumed.notify_one();
+				}
+				if (!loader->iCancelled)
+					aWork(loader->iOwner);
+			});
+		}
+	private:
+		text_edit& iOwner;
+		std::thread::id iOwnerThread;
+		std::weak_ptr<text_loader> iSelf;
+		std::unique_ptr<std::istream> iStream;
+		std::optional<neogfx::font> iFont;
+		std::vector<std::unique_ptr<graphics_context>> iGraphicsContexts;
+		std::thread iThread;
+		std::mutex iMutex;
+		std::condition_variable iChunkConsumed;
+		std::atomic<bool> iCancelled;
+		uint32_t iChunksInFlight;
+	};
+
+	class text_edit::text_finder
+	{
+	public:
+		static constexpr std::size_t BatchSize = 4096;
+	public:
+		text_finder(text_edit& aOwner, std::u32string&& aText) :
+			iOwner{ aOwner }, iOwnerThread{ std::this_thread::get_id() }, iSearch{ aOwner.iFindPattern, aOwner.iFindOptions }, iText{ std::move(aText) }, iCancelled{ false }
+		{
+		}
+		~text_finder()
+		{
+			iCancelled = true;
+			if (iThread.joinable())
+				iThread.join();
+		}
+	public:
+		void start(const std::shared_ptr<text_finder>& aSelf)
+		{
+			iSelf = aSelf;
+			iThread = std::thread{ [this]() { find(); } };
+		}
+	private:
+		void find()
+		{
+			text_search::match_list batch;
+			iSearch.for_each_match(iText.begin(), iText.end(), 0, [this, &batch](const text_search::match& aMatch)
+			{
+				batch.push_back(aMatch);
+				if (batch.size() == BatchSize)
+				{
+					post(std::move(batch), false);
+					batch.clear();
+				}
+				return true;
+			}, &iCancelled);
+			if (!iCancelled)
+				post(std::move(batch), true);
+		}
+		void post(text_search::match_list&& aMatches, bool aFinished)
+		{
+			std::weak_ptr<text_finder> self = iSelf;
+			auto matches = std::make_shared<text_search::match_list>(std::move(aMatches));
+			async_event_queue::instance().enqueue_to_thread(iOwnerThread, [self, matches, aFinished]()
+			{
+				auto finder = self.lock();
+				if (finder != nullptr && !finder->iCancelled)
+					finder->iOwner.found_matches(*matches, aFinished);
+			});
+		}
+	private:
+		text_edit& iOwner;
+		std::thread::id iOwnerThread;
+		std::weak_ptr<text_finder> iSelf;
+		text_search iSearch;
+		std::u32string iText;
+		std::thread iThread;
+		std::atomic<bool> iCancelled;
+	};
+
+	class text_edit::html_importer : public html::i_visitor
+	{
+	public:
+		static constexpr std::size_t FlushSize = 64 * 1024;
+	private:
+		struct element
+		{
+			std::string name;
+			style textStyle;
+			bool preformatted;
+			bool hidden;
+		};
+	public:
+		html_importer(text_edit& aOwner, position_type aPosition) :
+			iOwner{ aOwner }, iPosition{ aPosition }, iLastChar{ U'\n' }
+		{
+			iElements.push_back(element{ std::string{}, style{}, false, false });
+		}
+	public:
+		position_type position() const
+		{
+			return iPosition;
+		}
+		void finish()
+		{
+			flush();
+		}
+	public:
+		void start_element(const std::string& aName, const html::attribute_list& aAttributes, bool aEmpty) override
+		{
+			if (aName == "br")
+			{
+				emit(U'\n');
+				return;
+			}
+			if (is_block(aName))
+				break_paragraph();
+			if (aEmpty || aName == "img" || aName == "hr" || aName == "meta" || aName == "link" || aName == "input" || aName == "col" || aName == "wbr")
+				return;
+			element e = iElements.back();
+			e.name = aName;
+			if (aName == "b" || aName == "strong" || aName == "th")
+				add_font_style(e.textStyle, font::Bold);
+			else if (aName == "i" || aName == "em" || aName == "cite" || aName == "var")
+				add_font_style(e.textStyle, font::Italic);
+			else if (aName == "u" || aName == "ins")
+				add_font_style(e.textStyle, font::Underline);
+			else if (aName.size() == 2 && aName[0] == 'h' && aName[1] >= '1' && aName[1] <= '6')
+			{
+				static const double sHeadingScale[] = { 2.0, 1.5, 1.17, 1.0, 0.83, 0.67 };
+				add_font_style(e.textStyle, font::Bold, sHeadingScale[aName[1] - '1']);
+			}
+			else if (aName == "pre" || aName == "code" || aName == "tt")
+				e.preformatted = (aName == "pre" || e.preformatted);
+			else if (aName == "head" || aName == "title" || aName == "script" || aName == "style" || aName == "template")
+				e.hidden = true;
+			for (const auto& attribute : aAttributes)
+			{
+				if (attribute.first == "style")
+					apply_css(e.textStyle, attribute.second);
+				else if (attribute.first == "color" && aName == "font")
+					set_colour(e.textStyle, attribute.second, false);
+				else if (attribute.first == "bgcolor")
+					set_colour(e.textStyle, attribute.second, true);
+				else if (attribute.first == "face" && aName == "font")
+					set_family(e.textStyle, attribute.second);
+			}
+			iElements.push_back(std::move(e));
+		}
+		void end_element(const std::string& aName) override
+		{
+			// elements are popped up to the matching one so unclosed elements (<p>, <li> etc) are tolerated
+			for (auto e = iElements.size(); e-- > 1;)
+				if (iElements[e].name == aName)
+				{
+					iElements.resize(e);
+					if (is_block(aName))
+						break_paragraph();
+					return;
+				}
+		}
+		void text(const std::string& aText) override
+		{
+			const auto& current = iElements.back();
+			if (current.hidden)
+				return;
+			for (auto ch : neolib::utf8_to_utf32(aText))
+			{
+				if (ch == U'\r')
+					continue;
+				if (!current.preformatted && (ch == U' ' || ch == U'\t' || ch == U'\n' || ch == U'\f'))
+				{
+					if (iLastChar != U' ' && iLastChar != U'\n')
+						emit(U' ');
+				}
+				else
+					emit(ch);
+			}
+		}
+	private:
+		static std::string trim(const std::string& aText)
+		{
+			auto const first = aText.find_first_not_of(" \t\r\n");
+			if (first == std::string::npos)
+				return std::string{};
+			return aText.substr(first, aText.find_last_not_of(" \t\r\n") - first + 1);
+		}
+		static bool is_block(const std::string& aName)
+		{
+			static const std::string sBlockElements[] =
+			{
+				"p", "div", "li", "ul", "ol", "dl", "dt", "dd", "tr", "table", "blockquote", "pre", "hr",
+				"h1", "h2", "h3", "h4", "h5", "h6", "section", "article", "header", "footer", "address", "figure"
+			};
+			return std::find(std::begin(sBlockElements), std::end(sBlockElements), aName) != std::end(sBlockElements);
+		}
+		font base_font(const style& aStyle) const
+		{
+			if (aStyle.font() != std::nullopt)
+				return *aStyle.font();
+			if (iOwner.default_style().font() != std::nullopt)
+				return *iOwner.default_style().font();
+			return iOwner.font();
+		}
+		void add_font_style(style& aStyle, font::style_e aFontStyle, double aScale = 1.0) const
+		{
+			auto const baseFont = base_font(aStyle);
+			auto const fontStyle = static_cast<font::style_e>((baseFont.style() & ~font::Normal) | aFontStyle);
+			aStyle.set_font(font{ baseFont, fontStyle, baseFont.size() * aScale });
+		}
+		void set_colour(style& aStyle, const std::string& aValue, bool aBackground) const
+		{
+			try
+			{
+				colour const value{ trim(aValue) };
+				if (aBackground)
+					aStyle.set_background_colour(value);
+				else
+					aStyle.set_text_colour(value);
+			}
+			catch (...)
+			{
+				// ignore colours we can't parse
+			}
+		}
+		void set_family(style& aStyle, const std::string& aValue) const
+		{
+			auto family = trim(aValue.substr(0, aValue.find(',')));
+			family.erase(std::remove(family.begin(), family.end(), '\''), family.end());
+			family.erase(std::remove(family.begin(), family.end(), '"'), family.end());
+			auto const baseFont = base_font(aStyle);
+			try
+			{
+				aStyle.set_font(font{ family, baseFont.style(), baseFont.size() });
+			}
+			catch (...)
+			{
+				// font not available
+			}
+		}
+		void apply_css(style& aStyle, const std::string& aDeclarations) const
+		{
+			for (std::string::size_type start = 0, end = 0; start < aDeclarations.size(); start = end + 1)
+			{
+				end = std::min(aDeclarations.find(';', start), aDeclarations.size());
+				auto const declaration = aDeclarations.substr(start, end - start);
+				auto const colon = declaration.find(':');
+				if (colon == std::string::npos)
+					continue;
+				auto property = trim(declaration.substr(0, colon));
+				auto value = trim(declaration.substr(colon + 1));
+				for (auto& ch : property)
+					ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+				if (property == "color")
+					set_colour(aStyle, value, false);
+				else if (property == "background-color" || property == "background")
+					set_colour(aStyle, value, true);
+				else if (property == "font-weight" && (value == "bold" || value == "bolder" || std::atoi(value.c_str()) >= 600))
+					add_font_style(aStyle, font::Bold);
+				else if (property == "font-style" && (value == "italic" || value == "oblique"))
+					add_font_style(aStyle, font::Italic);
+				else if (property == "text-decoration" && value.find("underline") != std::string::npos)
+					add_font_style(aStyle, font::Underline);
+				else if (property == "font-family")
+					set_family(aStyle, value);
+				else if (property == "font-size")
+				{
+					auto const size = std::atof(value.c_str());
+					auto const baseFont = base_font(aStyle);
+					if (size > 0.0 && value.find("pt") != std::string::npos)
+						aStyle.set_font(font{ baseFont, baseFont.style(), size });
+					else if (size > 0.0 && value.find("px") != std::string::npos)
+						aStyle.set_font(font{ baseFont, baseFont.style(), size * 0.75 });
+					else if (size > 0.0 && value.find("em") != std::string::npos)
+						aStyle.set_font(font{ baseFont, baseFont.style(), baseFont.size() * size });
+				}
+			}
+		}
+		void break_paragraph()
+		{
+			if (iLastChar == U'\n')
+				return;
+			if (!iPending.empty() && iPending.back() == U' ')
+				iPending.pop_back();
+			emit(U'\n');
+		}
+		void emit(char32_t aChar)
+		{
+			const auto& currentStyle = iElements.back().textStyle;
+			if (!iPending.empty() && currentStyle != iPendingStyle)
+				flush();
+			if (iPending.empty())
+				iPendingStyle = currentStyle;
+			iPending.push_back(aChar == U'\n' && iOwner.iType == SingleLine ? U' ' : aChar);
+			iLastChar = aChar;
+			if (iPending.size() >= FlushSize)
+				flush();
+		}
+		void flush()
+		{
+			// runs go straight into the document; the caller reshapes the inserted text once at the end
+			if (iPending.empty())
+				return;
+			auto s = (iPendingStyle != style{} ? iOwner.iStyles.insert(style{ iOwner, iPendingStyle }).first : iOwner.iStyles.end());
+			auto const textTag = (s != iOwner.iStyles.end() ? document_text::tag_type{ static_cast<style_list::const_iterator>(s) } : document_text::tag_type{ nullptr });
+			iOwner.iText.insert(textTag, iOwner.iText.begin() + iPosition, iPending.begin(), iPending.end());
+			iPosition += iPending.size();
+			iPending.clear();
+		}
+	private:
+		text_edit& iOwner;
+		position_type iPosition;
+		std::vector<element> iElements;
+		std::u32string iPending;
+		style iPendingStyle;
+		char32_t iLastChar;
+	};
+
 	text_edit::text_edit(type_e aType, frame_style aFrameStyle) :
 		scrollable_widget{ aType == MultiLine ? scrollbar_style::Normal : scrollbar_style::Invisible, aFrameStyle },
 		iType{ aType },
 		iPersistDefaultStyle{ false },
 		iGlyphColumns{ 1 },
+		iLoadedChunksSinceRefresh{ 0u },
 		iCursorAnimationStartTime{ app::instance().program_elapsed_ms() },
 		iTabStopHint{ "0000" },
 		iAnimator{ app::instance(), [this](neolib::callback_timer&)
@@ -172,7 +750,11 @@ namespace neogfx
 		}, 40 },
 		iSuppressTextChangedNotification{ 0u },
 		iWantedToNotfiyTextChanged{ 0u },
-		iOutOfMemory{ false }
+		iOutOfMemory{ false },
+		iUpdatingScrollbarVisibility{ false },
+		iUndoTextSize{ 0 },
+		iUndoGroupStarted{ false },
+		iUndoRedoInProgress{ false }
 	{
 		init();
 	}
@@ -182,6 +764,7 @@ namespace neogfx
 		iType{ aType },
 		iPersistDefaultStyle{ false },
 		iGlyphColumns{ 1 },
+		iLoadedChunksSinceRefresh{ 0u },
 		iCursorAnimationStartTime{ app::instance().program_elapsed_ms() },
 		iTabStopHint{ "0000" },
 		iAnimator{ app::instance(), [this](neolib::callback_timer&)
@@ -191,7 +774,11 @@ namespace neogfx
 		}, 40 },
 		iSuppressTextChangedNotification{ 0u },
 		iWantedToNotfiyTextChanged{ 0u },
-		iOutOfMemory{ false }
+		iOutOfMemory{ false },
+		iUpdatingScrollbarVisibility{ false },
+		iUndoTextSize{ 0 },
+		iUndoGroupStarted{ false },
+		iUndoRedoInProgress{ false }
 	{
 		init();
 	}
@@ -201,6 +788,7 @@ namespace neogfx
 		iType{ aType },
 		iPersistDefaultStyle{ false },
 		iGlyphColumns{ 1 },
+		iLoadedChunksSinceRefresh{ 0u },
 		iCursorAnimationStartTime{ app::instance().program_elapsed_ms() },
 		iTabStopHint{ "0000" },
 		iAnimator{ app::instance(), [this](neolib::callback_timer&)
@@ -210,13 +798,19 @@ namespace neogfx
 		}, 40 },
 		iSuppressTextChangedNotification{ 0u },
 		iWantedToNotfiyTextChanged{ 0u },
-		iOutOfMemory{ false }
+		iOutOfMemory{ false },
+		iUpdatingScrollbarVisibility{ false },
+		iUndoTextSize{ 0 },
+		iUndoGroupStarted{ false },
+		iUndoRedoInProgress{ false }
 	{
 		init();
 	}
 
 	text_edit::~text_edit()
 	{
+		cancel_load_text();
+		iTextFinder.reset();
 		if (app::instance().clipboard().sink_active() && &app::instance().clipboard().active_sink() == this)
 			app::instance().clipboard().deactivate(*this);
 	}
@@ -543,6 +1137,12 @@ namespace neogfx
 		return neogfx::scrolling_disposition::DontScrollChildWidget;
 	}
 
+	void text_edit::update_scrollbar_visibility()
+	{
+		neolib::scoped_flag sf{ iUpdatingScrollbarVisibility };
+		scrollable_widget::update_scrollbar_visibility();
+	}
+
 	void text_edit::update_scrollbar_visibility(usv_stage_e aStage)
 	{
 		switch (aStage)
@@ -604,6 +1204,13 @@ namespace neogfx
 		}
 	}
 
+	void text_edit::scrollbar_updated(const i_scrollbar& aScrollbar, i_scrollbar::update_reason_e aReason)
+	{
+		scrollable_widget::scrollbar_updated(aScrollbar, aReason);
+		if (aScrollbar.type() == scrollbar_type::Vertical)
+			refresh_estimated_lines();
+	}
+
 	colour text_edit::frame_colour() const
 	{
 		if (app::instance().current_style().palette().colour().similar_intensity(background_colour(), 0.03125))
@@ -613,12 +1220,12 @@ namespace neogfx
 
 	bool text_edit::can_undo() const
 	{
-		return iPreviousText != iText;
+		return !iUndoStack.empty();
 	}
 
 	bool text_edit::can_redo() const
 	{
-		return iPreviousText != iText;
+		return !iRedoStack.empty();
 	}
 
 	bool text_edit::can_cut() const
@@ -648,19 +1255,54 @@ namespace neogfx
 
 	void text_edit::undo(i_clipboard&)
 	{
-		// todo: more intelligent undo
-		iText.swap(iPreviousText);
-		refresh_paragraph(iText.begin(), 0);
+		if (iUndoStack.empty())
+			return;
+		auto entry = std::move(iUndoStack.back());
+		iUndoStack.pop_back();
+		iUndoTextSize -= undo_size(entry);
+		{
+			neolib::scoped_flag sf{ iUndoRedoInProgress };
+			bool const batch = (entry.operations.size() > UndoBatchThreshold);
+			for (auto operation = entry.operations.rbegin(); operation != entry.operations.rend(); ++operation)
+				apply_undo_operation(*operation, true, !batch);
+			if (batch)
+			{
+				refresh_paragraph(iText.begin(), 0);
+				restart_find();
+			}
+		}
+		iUndoGroupStarted = false;
 		update();
-		cursor().set_position(iText.size());
-		if (iPreviousText != iText)
-			notify_text_changed();
+		cursor().set_position(entry.cursorAnchor);
+		cursor().set_position(entry.cursorPosition, false);
+		iRedoStack.push_back(std::move(entry));
+		notify_text_changed();
 	}
 
-	void text_edit::redo(i_clipboard& aClipboard)
+	void text_edit::redo(i_clipboard&)
 	{
-		// todo: more intelligent redo
-		undo(aClipboard);
+		if (iRedoStack.empty())
+			return;
+		auto entry = std::move(iRedoStack.back());
+		iRedoStack.pop_back();
+		{
+			neolib::scoped_flag sf{ iUndoRedoInProgress };
+			bool const batch = (entry.operations.size() > UndoBatchThreshold);
+			for (const auto& operation : entry.operations)
+				apply_undo_operation(operation, false, !batch);
+			if (batch)
+			{
+				refresh_paragraph(iText.begin(), 0);
+				restart_find();
+			}
+		}
+		iUndoGroupStarted = false;
+		update();
+		const auto& last = entry.operations.back();
+		cursor().set_position(last.position + (last.type == undo_operation::Insert ? undo_size(last.text) : 0));
+		iUndoTextSize += undo_size(entry);
+		iUndoStack.push_back(std::move(entry));
+		notify_text_changed();
 	}
 
 	void text_edit::cut(i_clipboard& aClipboard)
@@ -854,16 +1496,65 @@ namespace neogfx
 		return set_text(aPlainText) != 0 || aPlainText.empty();
 	}
 
-	std::string text_edit::rich_text(rich_text_format aFormat) const
+	std::string text_edit::rich_text(rich_text_format) const
 	{
-		// todo
-		return text();
+		std::string result = "<html><body>";
+		result.reserve(iText.size() + result.size());
+		std::u32string run;
+		auto const flush = [&result, &run](const style* aStyle)
+		{
+			if (run.empty())
+				return;
+			std::string css;
+			if (aStyle != nullptr)
+			{
+				if (aStyle->font() != std::nullopt)
+				{
+					const auto& runFont = *aStyle->font();
+					css += "font-family:'" + runFont.family_name() + "';font-size:" + boost::lexical_cast<std::string>(runFont.size()) + "pt;";
+					if ((runFont.style() & font::Bold) == font::Bold)
+						css += "font-weight:bold;";
+					if ((runFont.style() & font::Italic) == font::Italic)
+						css += "font-style:italic;";
+					if ((runFont.style() & font::Underline) == font::Underline)
+						css += "text-decoration:underline;";
+				}
+				if (std::holds_alternative<colour>(aStyle->text_colour()))
+					css += "color:" + static_variant_cast<const colour&>(aStyle->text_colour()).to_hex_string() + ";";
+				if (std::holds_alternative<colour>(aStyle->background_colour()))
+					css += "background-color:" + static_variant_cast<const colour&>(aStyle->background_colour()).to_hex_string() + ";";
+			}
+			if (!css.empty())
+				result += "<span style=\"" + css + "\">";
+			std::string::size_type lineStart = 0;
+			auto const text = html::escape(neolib::utf32_to_utf8(run));
+			for (auto lineEnd = text.find('\n'); lineEnd != std::string::npos; lineStart = lineEnd + 1, lineEnd = text.find('\n', lineStart))
+				result.append(text, lineStart, lineEnd - lineStart).append("<br>\n");
+			result.append(text, lineStart, std::string::npos);
+			if (!css.empty())
+				result += "</span>";
+			run.clear();
+		};
+		const style* runStyle = nullptr;
+		for (auto ch = iText.begin(); ch != iText.end(); ++ch)
+		{
+			const auto& tagContents = iText.tag(ch).contents();
+			const style* charStyle = std::holds_alternative<style_list::const_iterator>(tagContents) ? &*static_variant_cast<style_list::const_iterator>(tagContents) : nullptr;
+			if (charStyle != runStyle)
+			{
+				flush(runStyle);
+				runStyle = charStyle;
+			}
+			run.push_back(*ch);
+		}
+		flush(runStyle);
+		result += "</body></html>";
+		return result;
 	}
 
-	bool text_edit::set_rich_text(const std::string& aRichText, rich_text_format aFormat)
+	bool text_edit::set_rich_text(const std::string& aRichText, rich_text_format)
 	{
-		// todo
-		return set_text(aRichText) != 0 || aRichText.empty();
+		return insert_rich_text(aRichText, true) != 0 || aRichText.empty();
 	}
 
 	void text_edit::paste_plain_text()
@@ -873,8 +1564,16 @@ namespace neogfx
 
 	void text_edit::paste_rich_text(rich_text_format aFormat)
 	{
-		// todo
-		paste(app::instance().clipboard());
+		auto& clipboard = app::instance().clipboard();
+		if (aFormat != rich_text_format::Html || !clipboard.has_html())
+		{
+			paste(clipboard);
+			return;
+		}
+		multiple_text_changes mtc{ *this };
+		if (cursor().position() != cursor().anchor())
+			delete_selected(clipboard);
+		insert_rich_text(clipboard.html(), false);
 	}
 
 	bool text_edit::read_only() const
@@ -999,6 +1698,106 @@ namespace neogfx
 		}
 	}
 
+	bool text_edit::find(const std::string& aPattern, const text_search_options& aOptions)
+	{
+		clear_find();
+		if (aPattern.empty())
+			return false;
+		auto pattern = neolib::utf8_to_utf32(aPattern);
+		iSearch = std::make_unique<text_search>(pattern, aOptions);
+		iFindPattern = std::move(pattern);
+		iFindOptions = aOptions;
+		restart_find();
+		auto const from = std::min(cursor().position(), cursor().anchor());
+		auto match = iSearch->find_first(iText.begin() + from, iText.end(), from);
+		if (match == std::nullopt)
+			match = iSearch->find_first(iText.begin(), iText.end());
+		if (match != std::nullopt)
+			select_match(*match);
+		return match != std::nullopt;
+	}
+
+	bool text_edit::find_next()
+	{
+		if (iSearch == nullptr)
+			return false;
+		auto const from = std::max(cursor().position(), cursor().anchor());
+		auto match = iSearch->find_first(iText.begin() + from, iText.end(), from);
+		if (match == std::nullopt)
+			match = iSearch->find_first(iText.begin(), iText.end());
+		if (match != std::nullopt)
+			select_match(*match);
+		return match != std::nullopt;
+	}
+
+	bool text_edit::find_previous()
+	{
+		if (iSearch == nullptr)
+			return false;
+		auto const to = std::min(cursor().position(), cursor().anchor());
+		auto match = iSearch->find_last(iText.begin(), iText.begin() + to);
+		if (match == std::nullopt)
+			match = iSearch->find_last(iText.begin(), iText.end());
+		if (match != std::nullopt)
+			select_match(*match);
+		return match != std::nullopt;
+	}
+
+	std::size_t text_edit::replace_all(const std::string& aReplacement)
+	{
+		if (iSearch == nullptr || read_only())
+			return 0;
+		text_search::match_list matches;
+		iSearch->find_all(iText.begin(), iText.end(), matches);
+		if (matches.empty())
+			return 0;
+		auto replacement = neolib::utf8_to_utf32(aReplacement);
+		replacement.erase(std::remove(replacement.begin(), replacement.end(), U'\r'), replacement.end());
+		if (iType == SingleLine)
+			replacement.erase(std::remove(replacement.begin(), replacement.end(), U'\n'), replacement.end());
+		// replace back to front so that the positions of the remaining matches stay valid; the text is then reshaped once
+		undo_entry entry{ {}, cursor().position(), cursor().anchor() };
+		for (auto m = matches.rbegin(); m != matches.rend(); ++m)
+		{
+			auto const textTag = iText.tag(iText.begin() + m->first);
+			entry.operations.push_back(undo_operation{ undo_operation::Erase, m->first, undoable_text(m->first, m->second) });
+			iText.erase(iText.begin() + m->first, iText.begin() + m->second);
+			if (!replacement.empty())
+			{
+				iText.insert(textTag, iText.begin() + m->first, replacement.begin(), replacement.end());
+				entry.operations.push_back(undo_operation{ undo_operation::Insert, m->first, undo_text{ std::make_pair(textTag, replacement) } });
+			}
+		}
+		push_undo(std::move(entry));
+		cursor().set_position(std::min(cursor().position(), iText.size()));
+		refresh_paragraph(iText.begin(), 0);
+		// the whole document has just been searched here so searching it again is no worse than a snapshot
+		restart_find(false);
+		update();
+		notify_text_changed();
+		return matches.size();
+	}
+
+	std::size_t text_edit::find_match_count() const
+	{
+		return iFindMatches.size();
+	}
+
+	bool text_edit::finding() const
+	{
+		return iTextFinder != nullptr;
+	}
+
+	void text_edit::clear_find()
+	{
+		iTextFinder.reset();
+		iFindEdits.clear();
+		iSearch.reset();
+		iFindPattern.clear();
+		iFindMatches.clear();
+		update();
+	}
+
 	text_edit::position_info text_edit::glyph_position(position_type aGlyphPosition, bool aForCursor) const
 	{
 		auto column = iGlyphColumns.begin();
@@ -1182,12 +1981,17 @@ namespace neogfx
 
 	void text_edit::clear()
 	{
+		clear_undo();
+		iTextFinder.reset();
+		iFindEdits.clear();
+		iFindMatches.clear();
 		cursor().set_position(0);
 		iText.clear();
 		iGlyphs.clear();
 		iGlyphParagraphs.clear();
 		for (std::size_t i = 0; i < iGlyphColumns.size(); ++i)
 			iGlyphColumns[i].lines().clear();
+		iLineRefreshState = std::nullopt;
 	}
 
 	std::string text_edit::text() const
@@ -1223,14 +2027,41 @@ namespace neogfx
 		auto eraseBegin = iText.begin() + aStart;
 		auto eraseEnd = iText.begin() + aEnd;
 		auto eraseAmount = eraseEnd - eraseBegin;
-		iPreviousText = iText;
+		record_undo(undo_operation{ undo_operation::Erase, aStart, undoable_text(aStart, aEnd) });
 		refresh_paragraph(iText.erase(eraseBegin, eraseEnd), -eraseAmount);
 		update();
-		if (iPreviousText != iText)
-			notify_text_changed();
+		notify_text_changed();
 	}
 
-	std::pair<text_edit::position_type, text_edit::position_type> text_edit::related_glyphs(position_type aGlyphPosition) const
+	void text_edit::load_text(const std::string& aFilePath)
+	{
+		auto stream = std::make_unique<std::ifstream>(aFilePath, std::ios::binary);
+		if (!*stream)
+			throw failed_to_open_file();
+		load_text(std::move(stream));
+	}
+
+	void text_edit::load_text(std::unique_ptr<std::istream> aStream)
+	{
+		cancel_load_text();
+		clear();
+		refresh_paragraph(iText.begin(), 0);
+		update();
+		iTextLoader = std::make_shared<text_loader>(*this, std::move(aStream));
+		iTextLoader->start(iTextLoader);
+	}
+
+	bool text_edit::loading_text() const
+	{
+		return iTextLoader != nullptr;
+	}
+
+	void text_edit::cancel_load_text()
+	{
+		iTextLoader.reset();
+	}
+
+	std::pair<text_edit::position_type, text_edit::position_type> text_edit::related_glyphs(position_type aGlyphPosition) const
 	{
 		std::pair<position_type, position_type> result{ aGlyphPosition, aGlyphPosition + 1 };
 		while (result.first > 0 && same_paragraph(aGlyphPosition, result.first - 1) && iGlyphs[result.first-1].source() == iGlyphs[aGlyphPosition].source())
@@ -1355,6 +2186,39 @@ namespace neogfx
 		iCalculatedTabStops.reset();
 	}
 
+	bool text_edit::has_syntax_highlighter() const
+	{
+		return iSyntaxHighlighter != nullptr;
+	}
+
+	const text_edit::i_syntax_highlighter& text_edit::syntax_highlighter() const
+	{
+		if (!has_syntax_highlighter())
+			throw no_syntax_highlighter();
+		return *iSyntaxHighlighter;
+	}
+
+	void text_edit::set_syntax_highlighter(std::shared_ptr<i_syntax_highlighter> aHighlighter)
+	{
+		iSyntaxHighlighter = aHighlighter;
+		rehighlight();
+	}
+
+	void text_edit::clear_syntax_highlighter()
+	{
+		set_syntax_highlighter(nullptr);
+	}
+
+	void text_edit::rehighlight()
+	{
+		for (auto const& paragraph : iGlyphParagraphs)
+			paragraph.first.clear_highlight();
+		iStaleHighlight.reset();
+		if (has_syntax_highlighter())
+			iStaleHighlight = std::make_pair(position_type{ 0 }, iText.size());
+		update();
+	}
+
 	void text_edit::init()
 	{
 		iDefaultFont = app::instance().current_style().font_info();
@@ -1378,6 +2242,7 @@ namespace neogfx
 		iSink += cursor().position_changed([this]()
 		{
 			iCursorAnimationStartTime = app::instance().program_elapsed_ms();
+			refresh_estimated_lines();
 			make_cursor_visible();
 			update();
 		});
@@ -1398,10 +2263,14 @@ namespace neogfx
 		if (!accept)
 			return 0;
 
-		iPreviousText = iText;
-
-		if (aClearFirst)
+		multiple_text_changes mtc{ *this };
+		bool changed = false;
+		if (aClearFirst && !iText.empty())
+		{
+			record_undo(undo_operation{ undo_operation::Erase, 0, undoable_text(0, iText.size()) });
 			iText.clear();
+			changed = true;
+		}
 
 		std::u32string text = neolib::utf8_to_utf32(aText);
 		if (iNormalizedTextBuffer.capacity() < text.size())
@@ -1419,17 +2288,69 @@ namespace neogfx
 		}
 		auto s = (&aStyle != &iDefaultStyle || iPersistDefaultStyle ? iStyles.insert(style(*this, aStyle)).first : iStyles.end());
 		auto insertionPoint = iText.begin() + cursor().position();
-		insertionPoint = iText.insert(s != iStyles.end() ? document_text::tag_type{ static_cast<style_list::const_iterator>(s) } : document_text::tag_type{ nullptr },
-			insertionPoint, iNormalizedTextBuffer.begin(), iNormalizedTextBuffer.begin() + eos);
-		refresh_paragraph(insertionPoint, eos);
+		auto const textTag = (s != iStyles.end() ? document_text::tag_type{ static_cast<style_list::const_iterator>(s) } : document_text::tag_type{ nullptr });
+		insertionPoint = iText.insert(textTag, insertionPoint, iNormalizedTextBuffer.begin(), iNormalizedTextBuffer.begin() + eos);
+		if (eos != 0)
+		{
+			record_undo(undo_operation{ undo_operation::Insert, static_cast<position_type>(insertionPoint - iText.begin()),
+				undo_text{ { textTag, std::u32string{ iNormalizedTextBuffer.begin(), iNormalizedTextBuffer.begin() + eos } } } });
+			changed = true;
+		}
+		if (aClearFirst)
+		{
+			refresh_paragraph(iText.begin(), 0);
+			restart_find();
+		}
+		else if (eos != 0)
+			refresh_paragraph(insertionPoint, eos);
 		update();
 		if (aMoveCursor)
 			cursor().set_position(insertionPoint - iText.begin() + eos);
-		if (iPreviousText != iText)
+		if (changed)
 			notify_text_changed();
 		return eos;
 	}
 
+	std::size_t text_edit::insert_rich_text(const std::string& aRichText, bool aClearFirst)
+	{
+		bool accept = true;
+		text_filter.trigger(aRichText, accept);
+		if (!accept)
+			return 0;
+
+		multiple_text_changes mtc{ *this };
+		bool changed = false;
+		if (aClearFirst && !iText.empty())
+		{
+			record_undo(undo_operation{ undo_operation::Erase, 0, undoable_text(0, iText.size()) });
+			iText.clear();
+			changed = true;
+		}
+
+		auto const start = static_cast<position_type>(aClearFirst ? 0 : cursor().position());
+		html_importer importer{ *this, start };
+		html{ aRichText, importer };
+		importer.finish();
+		auto const inserted = importer.position() - start;
+		if (inserted != 0)
+		{
+			record_undo(undo_operation{ undo_operation::Insert, start, undoable_text(start, importer.position()) });
+			changed = true;
+		}
+		if (aClearFirst)
+		{
+			refresh_paragraph(iText.begin(), 0);
+			restart_find();
+		}
+		else if (inserted != 0)
+			refresh_paragraph(iText.begin() + start, inserted);
+		update();
+		cursor().set_position(importer.position());
+		if (changed)
+			notify_text_changed();
+		return inserted;
+	}
+
 	void text_edit::delete_any_selection()
 	{
 		if (cursor().position() != cursor().anchor())
@@ -1447,6 +2368,151 @@ namespace neogfx
 			++iWantedToNotfiyTextChanged;
 	}
 
+	std::optional<neogfx::font> text_edit::loaded_text_font() const
+	{
+		// the font that refresh_paragraph's font selector picks for loaded text if that text can be shaped off the UI thread
+		if (iType != MultiLine || columns() != 1 || password())
+			return std::nullopt;
+		const auto& columnStyle = column(0).style();
+		const auto& style = (iPersistDefaultStyle || columnStyle.font() == std::nullopt ? iDefaultStyle : columnStyle);
+		return style.font() != std::nullopt ? *style.font() : font();
+	}
+
+	void text_edit::append_loaded_text(const std::u32string& aText, const std::optional<neogfx::font>& aShapingFont, const std::vector<glyph_text::container>& aShapedParagraphs)
+	{
+		auto eos = aText.size();
+		if (iType == SingleLine)
+		{
+			auto eol = aText.find(U'\n');
+			if (eol != std::u32string::npos)
+				eos = eol;
+		}
+		auto s = (iPersistDefaultStyle ? iStyles.insert(style(*this, iDefaultStyle)).first : iStyles.end());
+		bool const appendsParagraphs = (iText.empty() || iText[iText.size() - 1] == U'\n');
+		auto insertionPoint = iText.insert(s != iStyles.end() ? document_text::tag_type{ static_cast<style_list::const_iterator>(s) } : document_text::tag_type{ nullptr },
+			iText.end(), aText.begin(), aText.begin() + eos);
+		if (eos != 0)
+		{
+			/* whole paragraphs appended to the end of the document leave the existing lines intact so lines are only
+			   refreshed every few chunks (and then only from where the last refresh stopped); paragraphs the loader has
+			   shaped are used as long as the font it shaped them with is still the one loaded text gets */
+			bool const useShaped = appendsParagraphs && aShapingFont != std::nullopt && loaded_text_font() == aShapingFont;
+			refresh_paragraph(insertionPoint, eos, !appendsParagraphs, useShaped ? &aShapedParagraphs : nullptr);
+			if (appendsParagraphs && ++iLoadedChunksSinceRefresh >= LoadedChunksPerRefresh)
+				refresh_loaded_lines();
+		}
+		update();
+		if (eos != aText.size())
+			text_loaded();
+	}
+
+	void text_edit::select_match(const text_search::match& aMatch)
+	{
+		cursor().set_position(aMatch.first);
+		cursor().set_position(aMatch.second, false);
+	}
+
+	void text_edit::restart_find(bool aAllowBackground)
+	{
+		iTextFinder.reset();
+		iFindEdits.clear();
+		iFindMatches.clear();
+		if (iSearch == nullptr)
+			return;
+		if (iText.size() <= SynchronousFindLimit || !aAllowBackground)
+		{
+			text_search::match_list matches;
+			iSearch->find_all(iText.begin(), iText.end(), matches);
+			iFindMatches.assign(matches.begin(), matches.end());
+		}
+		else
+		{
+			// large documents are searched on a snapshot in the background; matches arrive in batches
+			iTextFinder = std::make_shared<text_finder>(*this, std::u32string{ iText.begin(), iText.end() });
+			iTextFinder->start(iTextFinder);
+		}
+		update();
+	}
+
+	void text_edit::update_find_matches(position_type aPosition, ptrdiff_t aDelta)
+	{
+		// a zero delta means the text is unchanged; callers that replace the text wholesale restart the find themselves
+		if (iSearch == nullptr || aDelta == 0)
+			return;
+		// only the paragraphs around the edit (widened by the pattern length for plain patterns) are searched again;
+		// matches after the edit are shifted by the edit delta. A search still running in the background is left to
+		// finish: the edit is recorded so that the matches it has yet to deliver can be adjusted (see found_matches).
+		auto const inserted = static_cast<position_type>(aDelta > 0 ? aDelta : 0);
+		auto const erased = static_cast<position_type>(aDelta < 0 ? -aDelta : 0);
+		auto const reach = static_cast<position_type>(iFindOptions.regex ? 0 : iFindPattern.size());
+		auto regionBegin = iText.begin() + (aPosition - std::min(aPosition, reach));
+		while (regionBegin != iText.begin() && *(regionBegin - 1) != U'\n')
+			--regionBegin;
+		auto regionEnd = std::find(iText.begin() + std::min(iText.size(), aPosition + inserted + reach), iText.end(), U'\n');
+		if (regionEnd != iText.end())
+			++regionEnd;
+		auto const regionStart = static_cast<position_type>(regionBegin - iText.begin());
+		auto const oldRegionEnd = static_cast<position_type>(regionEnd - iText.begin()) - inserted + erased;
+		auto first = std::lower_bound(iFindMatches.begin(), iFindMatches.end(), regionStart,
+			[](const find_span& aMatch, position_type aValue) { return aMatch.second <= aValue; });
+		auto last = std::lower_bound(first, iFindMatches.end(), oldRegionEnd,
+			[](const find_span& aMatch, position_type aValue) { return aMatch.first < aValue; });
+		for (auto m = last; m != iFindMatches.end(); ++m)
+		{
+			m->first = static_cast<position_type>(static_cast<ptrdiff_t>(m->first) + aDelta);
+			m->second = static_cast<position_type>(static_cast<ptrdiff_t>(m->second) + aDelta);
+		}
+		text_search::match_list matches;
+		iSearch->find_all(regionBegin, regionEnd, matches, regionStart);
+		iFindMatches.insert(iFindMatches.erase(first, last), matches.begin(), matches.end());
+		if (iTextFinder != nullptr)
+			iFindEdits.push_back(find_edit{ regionStart, oldRegionEnd, aDelta });
+	}
+
+	void text_edit::found_matches(const text_search::match_list& aMatches, bool aFinished)
+	{
+		// matches are positions in the text as it was when the search started; each edit made since shifts the matches
+		// after it and supersedes those within the region it searched again
+		std::vector<find_span> found;
+		found.reserve(aMatches.size());
+		for (auto const& match : aMatches)
+		{
+			find_span span{ match.first, match.second };
+			bool superseded = false;
+			for (auto const& edit : iFindEdits)
+			{
+				if (span.second > edit.start && span.first < edit.end)
+				{
+					superseded = true;
+					break;
+				}
+				if (span.first >= edit.end)
+				{
+					span.first = static_cast<position_type>(static_cast<ptrdiff_t>(span.first) + edit.delta);
+					span.second = static_cast<position_type>(static_cast<ptrdiff_t>(span.second) + edit.delta);
+				}
+			}
+			if (!superseded)
+				found.push_back(span);
+		}
+		auto const middle = iFindMatches.insert(iFindMatches.end(), found.begin(), found.end());
+		std::inplace_merge(iFindMatches.begin(), middle, iFindMatches.end());
+		if (aFinished)
+		{
+			iTextFinder.reset();
+			iFindEdits.clear();
+		}
+		update();
+	}
+
+	void text_edit::text_loaded()
+	{
+		iTextLoader.reset();
+		if (iLoadedChunksSinceRefresh != 0u)
+			refresh_loaded_lines();
+		notify_text_changed();
+	}
+
 	text_edit::document_glyphs::const_iterator text_edit::to_glyph(document_text::const_iterator aWhere) const
 	{
 		std::size_t textIndex = static_cast<std::size_t>(aWhere - iText.begin());
@@ -1484,36 +2550,335 @@ namespace neogfx
 		return std::make_pair(iText.size(), iText.size());
 	}
 
-	void text_edit::refresh_paragraph(document_text::const_iterator aWhere, ptrdiff_t aDelta)
+	text_edit::undo_text text_edit::undoable_text(position_type aStart, position_type aEnd) const
+	{
+		undo_text result;
+		auto const end = iText.begin() + aEnd;
+		for (auto i = iText.begin() + aStart; i != end; ++i)
+		{
+			const auto& textTag = iText.tag(i);
+			if (result.empty() || result.back().first != textTag)
+				result.emplace_back(textTag, std::u32string{});
+			result.back().second.push_back(*i);
+		}
+		return result;
+	}
+
+	std::size_t text_edit::undo_size(const undo_text& aText)
+	{
+		std::size_t result = 0;
+		for (const auto& run : aText)
+			result += run.second.size();
+		return result;
+	}
+
+	std::size_t text_edit::undo_size(const undo_entry& aEntry)
+	{
+		std::size_t result = 0;
+		for (const auto& operation : aEntry.operations)
+			result += undo_size(operation.text);
+		return result;
+	}
+
+	void text_edit::record_undo(undo_operation&& aOperation)
+	{
+		if (iUndoRedoInProgress)
+			return;
+		iRedoStack.clear();
+		iUndoTextSize += undo_size(aOperation.text);
+		if (iSuppressTextChangedNotification != 0u && iUndoGroupStarted && !iUndoStack.empty())
+			iUndoStack.back().operations.push_back(std::move(aOperation));
+		else if (!coalesce_undo(aOperation))
+			iUndoStack.push_back(undo_entry{ { std::move(aOperation) }, cursor().position(), cursor().anchor() });
+		iUndoGroupStarted = (iSuppressTextChangedNotification != 0u);
+		trim_undo();
+	}
+
+	void text_edit::push_undo(undo_entry&& aEntry)
+	{
+		iRedoStack.clear();
+		iUndoTextSize += undo_size(aEntry);
+		iUndoStack.push_back(std::move(aEntry));
+		iUndoGroupStarted = false;
+		trim_undo();
+	}
+
+	void text_edit::trim_undo()
+	{
+		while (!iUndoStack.empty() && (iUndoStack.size() > UndoDepth || iUndoTextSize > UndoTextLimit))
+		{
+			iUndoTextSize -= undo_size(iUndoStack.front());
+			iUndoStack.pop_front();
+		}
+	}
+
+	bool text_edit::coalesce_undo(undo_operation& aOperation)
+	{
+		// consecutive typing (or consecutive backspaces/deletes) within a line becomes a single undo entry
+		if (iUndoStack.empty() || iUndoStack.back().operations.size() != 1)
+			return false;
+		auto& previous = iUndoStack.back().operations.back();
+		if (previous.type != aOperation.type || previous.text.empty() || aOperation.text.empty())
+			return false;
+		auto const hasNewLine = [](const undo_text& aText)
+		{
+			for (const auto& run : aText)
+				if (run.second.find(U'\n') != std::u32string::npos)
+					return true;
+			return false;
+		};
+		if (hasNewLine(previous.text) || hasNewLine(aOperation.text))
+			return false;
+		auto const append = [](undo_text& aText, undo_text& aMore)
+		{
+			for (auto& run : aMore)
+				if (aText.back().first == run.first)
+					aText.back().second += run.second;
+				else
+					aText.push_back(std::move(run));
+		};
+		if (aOperation.type == undo_operation::Insert && previous.position + undo_size(previous.text) == aOperation.position)
+			append(previous.text, aOperation.text);
+		else if (aOperation.type == undo_operation::Erase && previous.position == aOperation.position)
+			append(previous.text, aOperation.text);
+		else if (aOperation.type == undo_operation::Erase && aOperation.position + undo_size(aOperation.text) == previous.position)
+		{
+			append(aOperation.text, previous.text);
+			previous.text = std::move(aOperation.text);
+			previous.position = aOperation.position;
+		}
+		else
+			return false;
+		return true;
+	}
+
+	void text_edit::apply_undo_operation(const undo_operation& aOperation, bool aReverse, bool aRefresh)
+	{
+		auto const length = undo_size(aOperation.text);
+		if (length == 0)
+			return;
+		if ((aOperation.type == undo_operation::Insert) != aReverse)
+		{
+			auto position = aOperation.position;
+			for (const auto& run : aOperation.text)
+			{
+				iText.insert(run.first, iText.begin() + position, run.second.begin(), run.second.end());
+				position += run.second.size();
+			}
+			if (aRefresh)
+				refresh_paragraph(iText.begin() + aOperation.position, length);
+		}
+		else
+		{
+			auto const next = iText.erase(iText.begin() + aOperation.position, iText.begin() + aOperation.position + length);
+			if (aRefresh)
+				refresh_paragraph(next, -static_cast<ptrdiff_t>(length));
+		}
+	}
+
+	void text_edit::clear_undo()
+	{
+		iUndoStack.clear();
+		iRedoStack.clear();
+		iUndoTextSize = 0;
+		iUndoGroupStarted = false;
+	}
+
+	void text_edit::refresh_paragraph(document_text::const_iterator aWhere, ptrdiff_t aDelta, bool aRefreshLines, const std::vector<glyph_text::container>* aShapedParagraphs)
 	{
-		/* simple (naive) implementation just to get things moving (so just refresh everything) ... */
-		(void)aWhere;
+		/* aWhere and aDelta describe an edit that has already been applied to iText (aDelta characters inserted at aWhere if
+		   positive, -aDelta characters erased at aWhere if negative); only the paragraphs touched by the edit are reshaped and
+		   spliced back into iGlyphs and iGlyphParagraphs. A zero delta means "something other than the text has changed"
+		   (font, columns, password etc) so everything is reshaped. aShapedParagraphs, if given, holds the already shaped
+		   glyphs (see graphics_context::shape_text) of each of the reshaped paragraphs in turn; empty entries are shaped here. */
+		update_find_matches(static_cast<position_type>(aWhere - iText.begin()), aDelta);
 		graphics_context gc{ *this, graphics_context::type::Unattached };
 		if (password())
 			gc.set_password(true, PasswordMask.value().empty() ? "\xE2\x97\x8F"s : PasswordMask);
-		iGlyphs.clear();
-		iGlyphParagraphs.clear();
+		bool const full = (aDelta == 0 || iGlyphParagraphs.empty());
+		auto const whereIndex = static_cast<document_text::size_type>(aWhere - iText.begin());
+		auto const oldTextSize = static_cast<document_text::size_type>(static_cast<ptrdiff_t>(iText.size()) - aDelta);
+		document_text::size_type textStart = 0;
+		document_text::size_type textEnd = iText.size();
+		document_glyphs::size_type glyphStart = 0;
+		glyph_paragraphs::const_iterator nextParagraph = iGlyphParagraphs.end();
+		if (!full)
+		{
+			auto first = character_to_paragraph(whereIndex);
+			if (first == iGlyphParagraphs.end() && whereIndex == oldTextSize && whereIndex > 0 && iText[whereIndex - 1] != U'\n')
+				first = std::prev(iGlyphParagraphs.end());
+			if (first != iGlyphParagraphs.end())
+			{
+				auto last = first;
+				if (aDelta < 0)
+				{
+					// erasing a paragraph's terminating newline joins it with the paragraph that follows the erased range
+					auto lastErased = character_to_paragraph(whereIndex - aDelta);
+					last = (lastErased != iGlyphParagraphs.end() ? lastErased : std::prev(iGlyphParagraphs.end()));
+				}
+				nextParagraph = std::next(last);
+				textStart = first->first.text_start_index();
+				glyphStart = first->first.start_index();
+				textEnd = (nextParagraph != iGlyphParagraphs.end() ? nextParagraph->first.text_start_index() : oldTextSize) + aDelta;
+				auto const glyphEnd = (nextParagraph != iGlyphParagraphs.end() ? nextParagraph->first.start_index() : iGlyphs.size());
+				iGlyphs.erase(iGlyphs.begin() + glyphStart, iGlyphs.begin() + glyphEnd);
+				nextParagraph = iGlyphParagraphs.erase(first, nextParagraph);
+			}
+			else if (whereIndex == oldTextSize)
+			{
+				textStart = whereIndex;
+				glyphStart = iGlyphs.size();
+			}
+			else
+				return refresh_paragraph(iText.begin(), 0);
+		}
+		else
+		{
+			iGlyphs.clear();
+			iGlyphParagraphs.clear();
+		}
+		invalidate_highlight(whereIndex, full ? 0 : aDelta, textStart, textEnd);
 		iCharacterToParagraphCache.clear();
 		iCharacterToParagraphCacheLastAccess.reset();
 		iGlyphToParagraphCache.clear();
 		iGlyphToParagraphCacheLastAccess.reset();
+		/* the paragraphs being refreshed are gathered in batches and, as they are independent of each other, a batch with
+		   enough text is shaped on the paragraph shaping pool (without glyph textures; finish_shaping adds those here on the
+		   UI thread); each batch is then spliced into iGlyphs and iGlyphParagraphs in order. */
+		typedef neolib::vecarray<std::u32string::size_type, 16, -1> column_delimiters;
+		struct pending_paragraph
+		{
+			document_text::const_iterator start;
+			document_text::const_iterator end;
+			column_delimiters columnDelimiters;
+			const glyph_text::container* shaped;
+			glyph_text::container glyphs;
+		};
+		auto const defaultFont = font();
+		std::vector<neogfx::font> columnFonts;
+		for (auto const& column : iGlyphColumns)
+		{
+			const auto& style = (column.style().font() != std::nullopt ? column.style() : iDefaultStyle);
+			columnFonts.push_back(style.font() != std::nullopt ? *style.font() : defaultFont);
+		}
+		const document_text& text = iText;
+		auto fontSelector = [&text, &columnFonts, &defaultFont](document_text::const_iterator aParagraphStart, const column_delimiters& aColumnDelimiters)
+		{
+			return [&text, &columnFonts, &defaultFont, aParagraphStart, &aColumnDelimiters](std::u32string::size_type aSourceIndex) -> neogfx::font
+			{
+				const auto& tagContents = text.tag(aParagraphStart + aSourceIndex).contents();
+				if (std::holds_alternative<style_list::const_iterator>(tagContents))
+				{
+					const auto& style = *static_variant_cast<style_list::const_iterator>(tagContents);
+					return style.font() != std::nullopt ? *style.font() : defaultFont;
+				}
+				std::size_t indexColumn = std::lower_bound(aColumnDelimiters.begin(), aColumnDelimiters.end(), aSourceIndex) - aColumnDelimiters.begin();
+				return columnFonts[std::min(indexColumn, columnFonts.size() - 1)];
+			};
+		};
+		auto& shapingPool = paragraph_shaping_pool::instance();
+		std::vector<std::unique_ptr<graphics_context>> shapingContexts;
+		std::vector<std::u32string> shapingBuffers;
+		std::vector<pending_paragraph> batch;
+		std::vector<pending_paragraph*> unshaped;
+		std::size_t paragraphIndex = 0;
 		std::u32string paragraphBuffer;
-		auto paragraphStart = iText.begin();
-		auto iterColumn = iGlyphColumns.begin();
-		neolib::vecarray<std::u32string::size_type, 16, -1> columnDelimiters;
-		auto fs = [this, paragraphStart, &columnDelimiters](std::u32string::size_type aSourceIndex)
-		{
-			const auto& tagContents = iText.tag(paragraphStart + aSourceIndex).contents();
-			std::size_t indexColumn = std::lower_bound(columnDelimiters.begin(), columnDelimiters.end(), aSourceIndex) - columnDelimiters.begin();
-			if (indexColumn > columns() - 1)
-				indexColumn = columns() - 1;
-			const auto& columnStyle = text_edit::column(indexColumn).style();
-			const auto& style =
-				std::holds_alternative<style_list::const_iterator>(tagContents) ? *static_variant_cast<style_list::const_iterator>(tagContents) :
-				columnStyle.font() != std::nullopt ? columnStyle : iDefaultStyle;
-			return style.font() != std::nullopt ? *style.font() : font();
+		glyph_text gt;
+		auto insertionPoint = iGlyphs.begin() + glyphStart;
+		auto refreshBatch = [&]()
+		{
+			unshaped.clear();
+			std::size_t unshapedCharacters = 0;
+			for (auto& paragraph : batch)
+			{
+				if (aShapedParagraphs != nullptr && paragraphIndex < aShapedParagraphs->size() && !(*aShapedParagraphs)[paragraphIndex].empty())
+					paragraph.shaped = &(*aShapedParagraphs)[paragraphIndex];
+				else
+				{
+					unshaped.push_back(&paragraph);
+					unshapedCharacters += static_cast<std::size_t>(paragraph.end - paragraph.start);
+				}
+				++paragraphIndex;
+			}
+			if (unshaped.size() > 1 && unshapedCharacters >= ParallelShapingThreshold && shapingPool.participants() > 1 && !password())
+			{
+				if (shapingContexts.empty())
+				{
+					for (std::size_t participant = 0u; participant < shapingPool.participants(); ++participant)
+						shapingContexts.push_back(std::make_unique<graphics_context>(*this, graphics_context::type::Unattached));
+					shapingBuffers.resize(shapingPool.participants());
+					create_fallback_fonts(defaultFont);
+					for (auto const& columnFont : columnFonts)
+						create_fallback_fonts(columnFont);
+					for (auto const& style : iStyles)
+						if (style.font() != std::nullopt)
+							create_fallback_fonts(*style.font());
+				}
+				// paragraphs that can't be shaped off the UI thread (those containing emoji) are left unshaped
+				shapingPool.run(unshaped.size(), [&](std::size_t aParticipant, std::size_t aIndex)
+				{
+					auto& paragraph = *unshaped[aIndex];
+					auto& buffer = shapingBuffers[aParticipant];
+					buffer.assign(paragraph.start, paragraph.end);
+					if (shapingContexts[aParticipant]->shape_text(buffer.begin(), buffer.end(), fontSelector(paragraph.start, paragraph.columnDelimiters), paragraph.glyphs) &&
+						!paragraph.glyphs.empty())
+						paragraph.shaped = &paragraph.glyphs;
+				});
+			}
+			for (auto& paragraph : batch)
+			{
+				auto const shaped = paragraph.shaped;
+				if (shaped == nullptr)
+				{
+					paragraphBuffer.assign(paragraph.start, paragraph.end);
+					gt = gc.to_glyph_text(paragraphBuffer.begin(), paragraphBuffer.end(), fontSelector(paragraph.start, paragraph.columnDelimiters));
+				}
+				auto const glyphsBegin = (shaped != nullptr ? shaped->cbegin() : gt.cbegin());
+				auto const glyphsEnd = (shaped != nullptr ? shaped->cend() : gt.cend());
+				if (glyphsBegin != glyphsEnd)
+				{
+					auto const glyphCount = static_cast<document_glyphs::size_type>(std::distance(glyphsBegin, glyphsEnd));
+					auto paragraphGlyphs = iGlyphs.insert(insertionPoint, glyphsBegin, glyphsEnd);
+					auto newParagraph = iGlyphParagraphs.insert(nextParagraph,
+						std::make_pair(
+							glyph_paragraph{ *this },
+							glyph_paragraph_index{
+								static_cast<std::size_t>(paragraph.end - paragraph.start),
+								glyphCount }),
+								glyph_paragraphs::skip_type{ glyph_paragraph_index{}, glyph_paragraph_index{} });
+					newParagraph->first.set_self(newParagraph);
+					coordinate x = 0.0;
+					auto paragraphColumn = iGlyphColumns.begin();
+					auto const paragraphGlyphsEnd = paragraphGlyphs + glyphCount;
+					for (auto iterGlyph = paragraphGlyphs; iterGlyph != paragraphGlyphsEnd; ++iterGlyph)
+					{
+						if (shaped != nullptr)
+							gc.finish_shaping(*iterGlyph);
+						if (*(paragraph.start + iterGlyph->source().first) == paragraphColumn->delimiter() && paragraphColumn + 1 != iGlyphColumns.end())
+						{
+							iterGlyph->set_advance(size{});
+							++paragraphColumn;
+							continue;
+						}
+						else if (iterGlyph->is_whitespace() && iterGlyph->value() == U'\t')
+						{
+							auto advance = iterGlyph->advance();
+							advance.cx = tab_stops() - std::fmod(x, tab_stops());
+							iterGlyph->set_advance(advance);
+						}
+						iterGlyph->x = x;
+						x += iterGlyph->advance().cx;
+					}
+					insertionPoint = paragraphGlyphsEnd;
+				}
+			}
+			batch.clear();
 		};
-		for (auto iterChar = iText.begin(); iterChar != iText.end(); ++iterChar)
+		document_text::const_iterator paragraphStart = iText.begin() + textStart;
+		document_text::const_iterator const textStop = iText.begin() + textEnd;
+		auto iterColumn = iGlyphColumns.begin();
+		column_delimiters columnDelimiters;
+		for (auto iterChar = paragraphStart; iterChar != textStop; ++iterChar)
 		{
 			auto& column = *(iterColumn);
 			auto ch = *iterChar;
@@ -1524,52 +2889,22 @@ namespace neogfx
 				continue;
 			}
 			bool newLine = (ch == U'\n');
-			if (newLine || iterChar == iText.end() - 1)
+			if (newLine || iterChar == textStop - 1)
 			{
-				paragraphBuffer.assign(paragraphStart, iterChar + 1);
-				auto gt = gc.to_glyph_text(paragraphBuffer.begin(), paragraphBuffer.end(), fs);
-				if (gt.cbegin() != gt.cend())
-				{
-					auto paragraphGlyphs = iGlyphs.insert(iGlyphs.end(), gt.cbegin(), gt.cend());
-					auto newParagraph = iGlyphParagraphs.insert(iGlyphParagraphs.end(),
-						std::make_pair(
-							glyph_paragraph{ *this },
-							glyph_paragraph_index{
-								static_cast<std::size_t>((iterChar + 1) - iText.begin()) - static_cast<std::size_t>(paragraphStart - iText.begin()),
-								iGlyphs.size() - static_cast<std::size_t>(paragraphGlyphs - iGlyphs.begin()) }),
-								glyph_paragraphs::skip_type{ glyph_paragraph_index{}, glyph_paragraph_index{} });
-					newParagraph->first.set_self(newParagraph);
-				}
+				batch.push_back(pending_paragraph{ paragraphStart, iterChar + 1, columnDelimiters, nullptr, {} });
+				if (batch.size() == ShapingBatchSize)
+					refreshBatch();
 				paragraphStart = iterChar + 1;
+				iterColumn = iGlyphColumns.begin();
 				columnDelimiters.clear();
 			}
 		}
-		for (auto p = iGlyphParagraphs.begin(); p != iGlyphParagraphs.end(); ++p)
+		refreshBatch();
+		if (aRefreshLines || full)
 		{
-			auto& paragraph = *p;
-			if (paragraph.first.start() == paragraph.first.end())
-				continue;
-			coordinate x = 0.0;
-			iterColumn = iGlyphColumns.begin();
-			for (auto iterGlyph = paragraph.first.start(); iterGlyph != paragraph.first.end(); ++iterGlyph)
-			{
-				if (iText[iterGlyph->source().first] == iterColumn->delimiter() && iterColumn + 1 != iGlyphColumns.end())
-				{
-					iterGlyph->set_advance(size{});
-					++iterColumn;
-					continue;
-				}
-				else if (iterGlyph->is_whitespace() && iterGlyph->value() == U'\t')
-				{
-					auto advance = iterGlyph->advance();
-					advance.cx = tab_stops() - std::fmod(x, tab_stops());
-					iterGlyph->set_advance(advance);
-				}
-				iterGlyph->x = x;
-				x += iterGlyph->advance().cx;
-			}
+			iLoadedChunksSinceRefresh = 0u;
+			refresh_columns();
 		}
-		refresh_columns();
 	}
 
 	void text_edit::refresh_columns()
@@ -1578,23 +2913,34 @@ namespace neogfx
 		update();
 	}
 
-	void text_edit::refresh_lines()
+	void text_edit::refresh_lines(bool aAppended)
 	{
 		try
 		{
-			/* simple (naive) implementation just to get things moving... */
+			/* each paragraph keeps the lines it was last wrapped into so only paragraphs that have been reshaped, or whose
+			   wrapping depends on a changed available width, are re-wrapped; paragraphs away from the viewport (and the cursor)
+			   that have no usable wrapping get an estimated height instead and are wrapped once they come into view. If
+			   paragraphs have only been appended since the last refresh (aAppended) it carries on from where that stopped. */
 			iOutOfMemory = false;
-			for (auto& column : iGlyphColumns)
-				column.lines().clear();
-			point pos{};
-			dimension availableWidth = client_rect(false).width();
-			dimension availableHeight = client_rect(false).height();
-			bool showVerticalScrollbar = false;
-			bool showHorizontalScrollbar = false;
-			iTextExtents = size{};
-			uint32_t pass = 1;
+			auto const clientExtents = client_rect(false).extents();
+			auto const previous = iLineRefreshState;
+			iLineRefreshState = std::nullopt;
+			bool const resume = aAppended && previous != std::nullopt && previous->clientExtents == clientExtents && previous->paragraphs <= iGlyphParagraphs.size();
+			if (!resume)
+				for (auto& column : iGlyphColumns)
+					column.lines().clear();
+			point pos{ 0.0, resume ? previous->y : 0.0 };
+			dimension availableWidth = resume ? previous->availableWidth : clientExtents.cx;
+			dimension availableHeight = resume ? previous->availableHeight : clientExtents.cy;
+			bool showVerticalScrollbar = resume && previous->showVerticalScrollbar;
+			bool showHorizontalScrollbar = resume && previous->showHorizontalScrollbar;
+			iTextExtents = size{ resume ? previous->width : 0.0, 0.0 };
+			uint32_t pass = resume ? previous->pass : 1;
+			auto const exactTop = vertical_scrollbar().position() - availableHeight;
+			auto const exactBottom = vertical_scrollbar().position() + availableHeight * 2.0;
+			auto const cursorGlyph = cursor_glyph_position();
 			auto iterColumn = iGlyphColumns.begin();
-			for (auto p = iGlyphParagraphs.begin(); p != iGlyphParagraphs.end();)
+			for (auto p = std::next(iGlyphParagraphs.begin(), resume ? previous->paragraphs : 0u); p != iGlyphParagraphs.end();)
 			{
 				auto& column = *iterColumn;
 				auto& lines = column.lines();
@@ -1619,90 +2965,55 @@ namespace neogfx
 							{ 0.0, height } });
 					pos.y += glyphFont.height();
 				}
-				else if (WordWrap && (paragraphEnd - 1)->x + (paragraphEnd - 1)->advance().cx > availableWidth)
+				else
 				{
-					auto insertionPoint = lines.end();
-					bool first = true;
-					auto next = paragraph.first.start();
-					auto lineStart = next;
-					auto lineEnd = paragraphEnd;
-					coordinate offset = 0.0;
-					while (next != paragraphEnd)
+					auto const wrapWidth = (WordWrap ? availableWidth : std::numeric_limits<dimension>::infinity());
+					auto const paragraphStartIndex = paragraph.first.start_index();
+					if (!paragraph.first.wrapped(wrapWidth))
 					{
-						auto split = std::lower_bound(next, paragraphEnd, paragraph_positioned_glyph{ offset + availableWidth });
-						if (split != next && (split != paragraphEnd || (split - 1)->x + (split - 1)->advance().cx >= offset + availableWidth))
-							--split;
-						if (split == next)
-							++split;
-						if (split != paragraphEnd)
+						auto const naturalWidth = paragraph.first.natural_width();
+						auto const estimatedHeight = (naturalWidth > wrapWidth ? std::ceil(naturalWidth / wrapWidth) : 1.0) * font().height();
+						bool const nearView = (pos.y <= exactBottom && pos.y + estimatedHeight >= exactTop) ||
+							(cursorGlyph >= paragraphStartIndex && cursorGlyph <= paragraph.first.end_index());
+						if (nearView)
+							wrap_paragraph(p, wrapWidth);
+						else
 						{
-							std::pair<document_glyphs::iterator, document_glyphs::iterator> wordBreak = word_break(lineStart, split, paragraphEnd);
-							lineEnd = wordBreak.first;
-							next = wordBreak.second;
-							if (wordBreak.first == wordBreak.second)
-							{
-								while (lineEnd != lineStart && (lineEnd - 1)->source() == wordBreak.first->source())
-									--lineEnd;
-								next = lineEnd;
-							}
+							auto lineEnd = paragraphEnd;
+							if ((lineEnd - 1)->is_line_breaking_whitespace())
+								--lineEnd;
+							lines.push_back(
+								glyph_line{
+									{ p - iGlyphParagraphs.begin(), p },
+									{ paragraphStartIndex, paragraphStart },
+									{ lineEnd - iGlyphs.begin(), lineEnd },
+									pos.y,
+									{ std::min(naturalWidth, wrapWidth), estimatedHeight },
+									true });
+							pos.y += estimatedHeight;
+							iTextExtents.cx = std::max(iTextExtents.cx, lines.back().extents.cx);
 						}
-						else
-							next = paragraphEnd;
-						dimension x = (split != iGlyphs.end() ? split->x : (lineStart != lineEnd ? iGlyphs.back().x + iGlyphs.back().advance().cx : 0.0));
-						auto height = paragraph.first.height(lineStart, lineEnd);
-						if (lineEnd != lineStart && (lineEnd - 1)->is_line_breaking_whitespace())
-							--lineEnd;
-						bool rtl = false;
-						if (!first &&
-							insertionPoint->lineStart != insertionPoint->lineEnd &&
-							lineStart != lineEnd &&
-							insertionPoint->lineStart.second->direction() == text_direction::RTL &&
-							(lineEnd - 1)->direction() == text_direction::RTL)
-							rtl = true; // todo: is this sufficient for multi-line RTL text?
-						if (!rtl)
-							insertionPoint = lines.end();
-						insertionPoint = lines.insert(insertionPoint,
-							glyph_line{
-								{ p - iGlyphParagraphs.begin(), p },
-								{ lineStart - iGlyphs.begin(), lineStart },
-								{ lineEnd - iGlyphs.begin(), lineEnd },
-								pos.y,
-								{ x - offset, height } });
-						if (rtl)
+					}
+					if (paragraph.first.wrapped(wrapWidth))
+					{
+						dimension paragraphHeight = 0.0;
+						for (auto const& wrappedLine : paragraph.first.wrapping())
 						{
-							auto ypos = (insertionPoint + 1)->ypos;
-							for (auto i = insertionPoint; i != lines.end(); ++i)
-							{
-								i->ypos = ypos;
-								ypos += i->extents.cy;
-							}
+							auto const lineStartIndex = paragraphStartIndex + wrappedLine.lineStart;
+							auto const lineEndIndex = paragraphStartIndex + wrappedLine.lineEnd;
+							lines.push_back(
+								glyph_line{
+									{ p - iGlyphParagraphs.begin(), p },
+									{ lineStartIndex, iGlyphs.begin() + lineStartIndex },
+									{ lineEndIndex, iGlyphs.begin() + lineEndIndex },
+									pos.y + wrappedLine.ypos,
+									wrappedLine.extents });
+							paragraphHeight += wrappedLine.extents.cy;
+							iTextExtents.cx = std::max(iTextExtents.cx, wrappedLine.extents.cx);
 						}
-						pos.y += height;
-						iTextExtents.cx = std::max(iTextExtents.cx, x - offset);
-						lineStart = next;
-						if (lineStart != paragraphEnd)
-							offset = lineStart->x;
-						lineEnd = paragraphEnd;
-						first = false;
+						pos.y += paragraphHeight;
 					}
 				}
-				else
-				{
-					auto lineStart = paragraphStart;
-					auto lineEnd = paragraphEnd;
-					auto height = paragraph.first.height(lineStart, lineEnd);
-					if (lineEnd != lineStart && (lineEnd - 1)->is_line_breaking_whitespace())
-						--lineEnd;
-					lines.push_back(
-						glyph_line{
-							{ p - iGlyphParagraphs.begin(), p },
-							{ lineStart - iGlyphs.begin(), lineStart },
-							{ lineEnd - iGlyphs.begin(), lineEnd },
-							pos.y,
-							{ (lineEnd - 1)->x + (lineEnd - 1)->advance().cx, height} });
-					pos.y += lines.back().extents.cy;
-					iTextExtents.cx = std::max(iTextExtents.cx, lines.back().extents.cx);
-				}
 				switch (pass)
 				{
 				case 1:
@@ -1736,6 +3047,7 @@ namespace neogfx
 					break;
 				}
 			}
+			iLineRefreshState = line_refresh_state{ iGlyphParagraphs.size(), clientExtents, availableWidth, availableHeight, showVerticalScrollbar, showHorizontalScrollbar, pass, pos.y, iTextExtents.cx };
 			if (!iGlyphs.empty() && iGlyphs.back().is_line_breaking_whitespace())
 				pos.y += font().height();
 			iTextExtents.cy = pos.y;
@@ -1744,10 +3056,207 @@ namespace neogfx
 		{
 			for (auto& column : iGlyphColumns)
 				column.lines().clear();
+			iLineRefreshState = std::nullopt;
 			iOutOfMemory = true;
 		}
 	}
 
+	void text_edit::refresh_loaded_lines()
+	{
+		iLoadedChunksSinceRefresh = 0u;
+		refresh_lines(true);
+		// only if the appended text changes which scrollbars are needed is a full refresh required
+		auto const clientExtents = client_rect(false).extents();
+		if ((iTextExtents.cy > clientExtents.cy) != vertical_scrollbar().visible() ||
+			(iTextExtents.cx > clientExtents.cx) != horizontal_scrollbar().visible())
+			refresh_columns();
+		else
+		{
+			vertical_scrollbar().set_maximum(iTextExtents.cy);
+			horizontal_scrollbar().set_maximum(iTextExtents.cx <= clientExtents.cx ? 0.0 : iTextExtents.cx);
+			update();
+		}
+	}
+
+	void text_edit::wrap_paragraph(glyph_paragraphs::iterator aParagraph, dimension aAvailableWidth)
+	{
+		auto& paragraph = aParagraph->first;
+		auto paragraphStart = paragraph.start();
+		auto paragraphEnd = paragraph.end();
+		glyph_paragraph::wrapped_lines lines;
+		coordinate y = 0.0;
+		if (paragraph.natural_width() > aAvailableWidth)
+		{
+			auto insertionPoint = lines.end();
+			bool first = true;
+			auto next = paragraphStart;
+			auto lineStart = next;
+			auto lineEnd = paragraphEnd;
+			coordinate offset = 0.0;
+			while (next != paragraphEnd)
+			{
+				auto split = std::lower_bound(next, paragraphEnd, paragraph_positioned_glyph{ offset + aAvailableWidth });
+				if (split != next && (split != paragraphEnd || (split - 1)->x + (split - 1)->advance().cx >= offset + aAvailableWidth))
+					--split;
+				if (split == next)
+					++split;
+				if (split != paragraphEnd)
+				{
+					std::pair<document_glyphs::iterator, document_glyphs::iterator> wordBreak = word_break(lineStart, split, paragraphEnd);
+					lineEnd = wordBreak.first;
+					next = wordBreak.second;
+					if (wordBreak.first == wordBreak.second)
+					{
+						while (lineEnd != lineStart && (lineEnd - 1)->source() == wordBreak.first->source())
+							--lineEnd;
+						next = lineEnd;
+					}
+				}
+				else
+					next = paragraphEnd;
+				dimension x = (split != paragraphEnd ? split->x : (lineStart != lineEnd ? (paragraphEnd - 1)->x + (paragraphEnd - 1)->advance().cx : 0.0));
+				auto height = paragraph.height(lineStart, lineEnd);
+				if (lineEnd != lineStart && (lineEnd - 1)->is_line_breaking_whitespace())
+					--lineEnd;
+				bool rtl = false;
+				if (!first &&
+					insertionPoint->lineStart != insertionPoint->lineEnd &&
+					lineStart != lineEnd &&
+					(paragraphStart + insertionPoint->lineStart)->direction() == text_direction::RTL &&
+					(lineEnd - 1)->direction() == text_direction::RTL)
+					rtl = true; // todo: is this sufficient for multi-line RTL text?
+				if (!rtl)
+					insertionPoint = lines.end();
+				insertionPoint = lines.insert(insertionPoint,
+					glyph_paragraph::wrapped_line{
+						static_cast<document_glyphs::size_type>(lineStart - paragraphStart),
+						static_cast<document_glyphs::size_type>(lineEnd - paragraphStart),
+						y,
+						{ x - offset, height } });
+				if (rtl)
+				{
+					auto ypos = (insertionPoint + 1)->ypos;
+					for (auto i = insertionPoint; i != lines.end(); ++i)
+					{
+						i->ypos = ypos;
+						ypos += i->extents.cy;
+					}
+				}
+				y += height;
+				lineStart = next;
+				if (lineStart != paragraphEnd)
+					offset = lineStart->x;
+				lineEnd = paragraphEnd;
+				first = false;
+			}
+		}
+		else
+		{
+			auto lineStart = paragraphStart;
+			auto lineEnd = paragraphEnd;
+			auto height = paragraph.height(lineStart, lineEnd);
+			if (lineEnd != lineStart && (lineEnd - 1)->is_line_breaking_whitespace())
+				--lineEnd;
+			lines.push_back(
+				glyph_paragraph::wrapped_line{
+					0,
+					static_cast<document_glyphs::size_type>(lineEnd - paragraphStart),
+					y,
+					{ (lineEnd - 1)->x + (lineEnd - 1)->advance().cx, height } });
+		}
+		paragraph.set_wrapping(aAvailableWidth, std::move(lines));
+	}
+
+	void text_edit::refresh_estimated_lines()
+	{
+		if (iUpdatingScrollbarVisibility || iOutOfMemory)
+			return;
+		bool estimated = false;
+		auto const top = vertical_scrollbar().position();
+		auto const bottom = top + client_rect(false).height();
+		for (auto const& column : iGlyphColumns)
+		{
+			auto const& lines = column.lines();
+			auto line = std::lower_bound(lines.begin(), lines.end(), glyph_line{ {}, {}, {}, top, {} },
+				[](const glyph_line& left, const glyph_line& right) { return left.ypos < right.ypos; });
+			if (line != lines.begin())
+				--line;
+			for (; !estimated && line != lines.end() && line->ypos <= bottom; ++line)
+				estimated = line->estimated;
+		}
+		if (!estimated)
+		{
+			auto const cursorPos = glyph_position(cursor_glyph_position(), true);
+			estimated = (cursorPos.line != cursorPos.column->lines().end() && cursorPos.line->estimated);
+		}
+		if (estimated)
+			refresh_columns();
+	}
+
+	void text_edit::invalidate_highlight(position_type aWhere, ptrdiff_t aDelta, position_type aStart, position_type aEnd)
+	{
+		// [aStart, aEnd) is the reshaped text; highlighting is stale from the first reshaped paragraph onwards and can only be
+		// considered converged once it has been redone past the last reshaped paragraph
+		if (!has_syntax_highlighter())
+			return;
+		if (iStaleHighlight == std::nullopt)
+		{
+			iStaleHighlight = std::make_pair(aStart, aEnd);
+			return;
+		}
+		auto const adjust = [aWhere, aDelta](position_type aPosition)
+		{
+			if (aPosition <= aWhere)
+				return aPosition;
+			if (aDelta < 0 && aPosition < aWhere - aDelta)
+				return aWhere;
+			return static_cast<position_type>(static_cast<ptrdiff_t>(aPosition) + aDelta);
+		};
+		iStaleHighlight->first = std::min(adjust(iStaleHighlight->first), aStart);
+		iStaleHighlight->second = std::max(adjust(iStaleHighlight->second), aEnd);
+	}
+
+	void text_edit::update_highlight(position_type aUpTo) const
+	{
+		/* re-lex paragraphs from the first stale one up to (and including) the one starting at aUpTo; a paragraph that was not
+		   reshaped and whose start state is unchanged keeps its runs, and once that happens past the reshaped text the lexer
+		   state has converged and the rest of the document is up to date. */
+		if (!has_syntax_highlighter() || iStaleHighlight == std::nullopt || iStaleHighlight->first > aUpTo)
+			return;
+		auto paragraph = character_to_paragraph(iStaleHighlight->first);
+		auto state = iSyntaxHighlighter->initial_state();
+		if (paragraph != iGlyphParagraphs.begin())
+		{
+			auto const& previous = std::prev(paragraph)->first.highlight();
+			if (previous != std::nullopt)
+				state = previous->endState;
+		}
+		std::u32string text;
+		for (; paragraph != iGlyphParagraphs.end(); ++paragraph)
+		{
+			auto const paragraphStart = paragraph->first.text_start_index();
+			if (paragraphStart > aUpTo)
+			{
+				iStaleHighlight->first = paragraphStart;
+				return;
+			}
+			auto const& existing = paragraph->first.highlight();
+			if (existing != std::nullopt && existing->startState == state)
+			{
+				if (paragraphStart >= iStaleHighlight->second)
+					break;
+				state = existing->endState;
+				continue;
+			}
+			text.assign(paragraph->first.text_start(), paragraph->first.text_end());
+			glyph_paragraph::highlight_info highlight{ state, state };
+			highlight.endState = iSyntaxHighlighter->highlight(text, state, highlight.runs);
+			state = highlight.endState;
+			paragraph->first.set_highlight(std::move(highlight));
+		}
+		iStaleHighlight.reset();
+	}
+
 	void text_edit::animate()
 	{
 		if (has_focus())
@@ -1785,9 +3294,27 @@ namespace neogfx
 		style result = iDefaultStyle;
 		result.merge(aColumn.style());
 		result.set_background_colour();
-		const auto& tagContents = iText.tag(iText.begin() + from_glyph(aGlyph).first).contents();
+		auto const textIndex = from_glyph(aGlyph).first;
+		const auto& tagContents = iText.tag(iText.begin() + textIndex).contents();
 		if (std::holds_alternative<style_list::const_iterator>(tagContents))
 			result.merge(*static_variant_cast<style_list::const_iterator>(tagContents));
+		if (has_syntax_highlighter())
+		{
+			auto paragraph = character_to_paragraph(textIndex);
+			if (paragraph != iGlyphParagraphs.end() && paragraph->first.highlight() != std::nullopt)
+			{
+				auto const& runs = paragraph->first.highlight()->runs;
+				auto const offset = textIndex - paragraph->first.text_start_index();
+				auto run = std::upper_bound(runs.begin(), runs.end(), offset,
+					[](std::size_t aOffset, const i_syntax_highlighter::style_run& aRun) { return aOffset < aRun.end; });
+				if (run != runs.end() && run->start <= offset)
+				{
+					auto runStyle = iSyntaxHighlighter->run_style(run->style);
+					runStyle.set_font();
+					result.merge(runStyle);
+				}
+			}
+		}
 		return result;
 	}
 
@@ -1797,6 +3324,8 @@ namespace neogfx
 		auto lineEnd = aLine->lineEnd.second;
 		if (lineEnd != lineStart && (lineEnd - 1)->is_line_breaking_whitespace())
 			--lineEnd;
+		if (has_syntax_highlighter() && aLine->paragraph.second != iGlyphParagraphs.end())
+			update_highlight(aLine->paragraph.second->first.text_start_index());
 		{
 			dimension outlineAdjust = 0.0;
 			for (uint32_t pass = 0; pass <= 1; ++pass)
@@ -1810,12 +3339,23 @@ namespace neogfx
 						auto gp = static_cast<cursor::position_type>(from_glyph(i).first);
 						selected = (gp >= std::min(cursor().position(), cursor().anchor()) && gp < std::max(cursor().position(), cursor().anchor()));
 					}
+					bool found = false;
+					if (pass == 0 && !iFindMatches.empty())
+					{
+						auto const gp = static_cast<position_type>(from_glyph(i).first);
+						auto match = std::lower_bound(iFindMatches.begin(), iFindMatches.end(), gp,
+							[](const find_span& aMatch, position_type aPosition) { return aMatch.second <= aPosition; });
+						found = (match != iFindMatches.end() && match->first <= gp);
+					}
 					const auto& glyph = *i;
 					const auto& style = glyph_style(i, aColumn);
 					const auto& glyphFont = style.font() != std::nullopt ? *style.font() : font();
 					switch (pass)
 					{
 					case 0:
+						if (found && !selected)
+							aGraphicsContext.fill_rect(rect{ pos, size{glyph.advance().cx, aLine->extents.cy} },
+								app::instance().current_style().palette().selection_colour().with_alpha(96));
 						if (selected)
 							aGraphicsContext.fill_rect(rect{ pos, size{glyph.advance().cx, aLine->extents.cy} }, 
 								has_focus() ? 
@@ -0,0 +1,209 @@
+// text_search.cpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+#include <cwctype>
+#include <regex>
+#include <neogfx/gui/widget/text_search.hpp>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEOGFX_TEXT_SEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace neogfx
+{
+	class text_search::regex_matcher
+	{
+	public:
+		regex_matcher(const std::u32string& aPattern, bool aCaseSensitive)
+		{
+			try
+			{
+				auto flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+				if (!aCaseSensitive)
+					flags |= std::regex_constants::icase;
+				iRegex.assign(to_wide(aPattern), flags);
+			}
+			catch (const std::regex_error&)
+			{
+				throw bad_pattern();
+			}
+		}
+	public:
+		// blocks are reused buffers so each one is converted afresh; nothing is cached between calls
+		bool search(const std::u32string& aBlock, position_type aFrom, position_type aStartLimit, const std::function<bool(const match&)>& aCallback) const
+		{
+			std::vector<position_type> toBlock;
+			std::vector<position_type> toWide;
+			auto const wide = to_wide(aBlock, &toBlock, &toWide);
+			for (auto pos = aFrom; pos < aStartLimit;)
+			{
+				match m;
+				if (!search(wide, toBlock, toWide[pos], m) || m.first >= aStartLimit)
+					break;
+				if (!aCallback(m))
+					return false;
+				pos = std::max(m.second, m.first + 1);
+			}
+			return true;
+		}
+	private:
+		bool search(const std::wstring& aWide, const std::vector<position_type>& aToBlock, position_type aFrom, match& aMatch) const
+		{
+			for (auto from = aFrom; from <= aWide.size();)
+			{
+				std::wsmatch result;
+				if (!std::regex_search(aWide.cbegin() + from, aWide.cend(), result, iRegex,
+					from != 0 ? std::regex_constants::match_prev_avail : std::regex_constants::match_default))
+					return false;
+				auto const start = from + static_cast<position_type>(result.position(0));
+				auto const end = start + static_cast<position_type>(result.length(0));
+				if (start != end)
+				{
+					aMatch = match{ aToBlock[start], aToBlock[end] };
+					return true;
+				}
+				from = start + 1;
+			}
+			return false;
+		}
+		static std::wstring to_wide(const std::u32string& aText, std::vector<position_type>* aToBlock = nullptr, std::vector<position_type>* aToWide = nullptr)
+		{
+			std::wstring result;
+			result.reserve(aText.size());
+			if (aToBlock != nullptr)
+				aToBlock->clear();
+			if (aToWide != nullptr)
+				aToWide->clear();
+			for (position_type i = 0; i < aText.size(); ++i)
+			{
+				auto const ch = aText[i];
+				if (aToWide != nullptr)
+					aToWide->push_back(result.size());
+				if (sizeof(wchar_t) == 2 && ch >= 0x10000)
+				{
+					result.push_back(static_cast<wchar_t>(0xD800 + ((ch - 0x10000) >> 10)));
+					if (aToBlock != nullptr)
+						aToBlock->push_back(i);
+					result.push_back(static_cast<wchar_t>(0xDC00 + ((ch - 0x10000) & 0x3FF)));
+				}
+				else
+					result.push_back(static_cast<wchar_t>(ch));
+				if (aToBlock != nullptr)
+					aToBlock->push_back(i);
+			}
+			if (aToBlock != nullptr)
+				aToBlock->push_back(aText.size());
+			if (aToWide != nullptr)
+				aToWide->push_back(result.size());
+			return result;
+		}
+	private:
+		std::wregex iRegex;
+	};
+
+	text_search::text_search(const std::u32string& aPattern, const text_search_options& aOptions) :
+		iPattern{ aPattern }, iOptions{ aOptions }
+	{
+		if (iOptions.regex)
+			iRegex = std::make_unique<regex_matcher>(iPattern, iOptions.caseSensitive);
+		else
+		{
+			if (!iOptions.caseSensitive)
+				fold(iPattern);
+			// Horspool shifts are bucketed on the low byte of each character; keeping the smallest shift per bucket is safe
+			iShift.fill(std::max<position_type>(iPattern.size(), 1));
+			for (position_type i = 0; i + 1 < iPattern.size(); ++i)
+				iShift[iPattern[i] & 0xFF] = iPattern.size() - 1 - i;
+		}
+	}
+
+	text_search::~text_search()
+	{
+	}
+
+	const std::u32string& text_search::pattern() const
+	{
+		return iPattern;
+	}
+
+	const text_search_options& text_search::options() const
+	{
+		return iOptions;
+	}
+
+	bool text_search::search(const std::u32string& aBlock, position_type aFrom, match& aMatch) const
+	{
+		if (iPattern.empty())
+			return false;
+		auto const pos = search_plain(aBlock.data(), aBlock.size(), aFrom);
+		if (pos == npos)
+			return false;
+		aMatch = match{ pos, pos + iPattern.size() };
+		return true;
+	}
+
+	bool text_search::search_regex(const std::u32string& aBlock, position_type aFrom, position_type aStartLimit, const std::function<bool(const match&)>& aCallback) const
+	{
+		return iRegex->search(aBlock, aFrom, aStartLimit, aCallback);
+	}
+
+	text_search::position_type text_search::search_plain(const char32_t* aText, position_type aLength, position_type aFrom) const
+	{
+		auto const m = iPattern.size();
+		if (aLength < m || aFrom > aLength - m)
+			return npos;
+		auto const last = aLength - m;
+		auto pos = aFrom;
+#ifdef NEOGFX_TEXT_SEARCH_SSE2
+		// compare the first and last pattern characters against four candidate positions at once and only verify
+		// the rest of the pattern where both agree
+		auto const firstCharacter = _mm_set1_epi32(static_cast<int>(iPattern.front()));
+		auto const lastCharacter = _mm_set1_epi32(static_cast<int>(iPattern.back()));
+		for (; pos + 3 <= last; pos += 4)
+		{
+			auto const candidateFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aText + pos));
+			auto const candidateLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aText + pos + m - 1));
+			auto const mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(
+				_mm_cmpeq_epi32(candidateFirst, firstCharacter), _mm_cmpeq_epi32(candidateLast, lastCharacter))));
+			if (mask == 0)
+				continue;
+			for (position_type lane = 0; lane < 4; ++lane)
+				if ((mask & (1 << lane)) != 0 && (m <= 2 || std::equal(iPattern.begin() + 1, iPattern.end() - 1, aText + pos + lane + 1)))
+					return pos + lane;
+		}
+#endif
+		while (pos <= last)
+		{
+			auto const ch = aText[pos + m - 1];
+			if (ch == iPattern.back() && std::equal(iPattern.begin(), iPattern.end() - 1, aText + pos))
+				return pos;
+			pos += iShift[ch & 0xFF];
+		}
+		return npos;
+	}
+
+	void text_search::fold(std::u32string& aText)
+	{
+		for (auto& ch : aText)
+			if (ch < 0x10000 || sizeof(wchar_t) == 4)
+				ch = static_cast<char32_t>(std::towlower(static_cast<std::wint_t>(ch)));
+	}
+}
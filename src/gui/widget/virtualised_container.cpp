@@ -0,0 +1,362 @@
+// virtualised_container.cpp
+/*
+  neogfx C++ GUI Library
+  Copyright (c) 2018 Leigh Johnston.  All Rights Reserved.
+  
+  This program is free software: you can redistribute it and / or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <neogfx/neogfx.hpp>
+#include <deque>
+#include <neolib/raii.hpp>
+#include <neogfx/gui/widget/virtualised_container.hpp>
+
+namespace neogfx
+{
+	virtualised_container::virtualised_container(widget_factory aFactory, scrollbar_style aScrollbarStyle, frame_style aFrameStyle) :
+		scrollable_widget{ aScrollbarStyle, aFrameStyle },
+		iFactory{ aFactory },
+		iItemCount{ 0u },
+		iOverscan{ DefaultOverscan },
+		iEstimatedExtent{ 0.0 },
+		iMeasuredTotal{ 0.0 },
+		iMeasuredCount{ 0u },
+		iRealising{ false }
+	{
+	}
+
+	virtualised_container::virtualised_container(i_widget& aParent, widget_factory aFactory, scrollbar_style aScrollbarStyle, frame_style aFrameStyle) :
+		scrollable_widget{ aParent, aScrollbarStyle, aFrameStyle },
+		iFactory{ aFactory },
+		iItemCount{ 0u },
+		iOverscan{ DefaultOverscan },
+		iEstimatedExtent{ 0.0 },
+		iMeasuredTotal{ 0.0 },
+		iMeasuredCount{ 0u },
+		iRealising{ false }
+	{
+	}
+
+	virtualised_container::virtualised_container(i_layout& aLayout, widget_factory aFactory, scrollbar_style aScrollbarStyle, frame_style aFrameStyle) :
+		scrollable_widget{ aLayout, aScrollbarStyle, aFrameStyle },
+		iFactory{ aFactory },
+		iItemCount{ 0u },
+		iOverscan{ DefaultOverscan },
+		iEstimatedExtent{ 0.0 },
+		iMeasuredTotal{ 0.0 },
+		iMeasuredCount{ 0u },
+		iRealising{ false }
+	{
+	}
+
+	virtualised_container::~virtualised_container()
+	{
+		iLive.clear();
+		iPool.clear();
+	}
+
+	virtualised_container::item_index virtualised_container::item_count() const
+	{
+		return iItemCount;
+	}
+
+	void virtualised_container::set_item_count(item_index aItemCount)
+	{
+		if (iItemCount == aItemCount)
+			return;
+		iItemCount = aItemCount;
+		for (auto i = iLive.begin(); i != iLive.end();)
+		{
+			if (i->first >= iItemCount)
+			{
+				recycle(i->second);
+				i = iLive.erase(i);
+			}
+			else
+				++i;
+		}
+		update_scrollbar_visibility();
+		update();
+	}
+
+	void virtualised_container::items_changed()
+	{
+		recycle_all();
+		update_scrollbar_visibility();
+		update();
+	}
+
+	uint32_t virtualised_container::overscan() const
+	{
+		return iOverscan;
+	}
+
+	void virtualised_container::set_overscan(uint32_t aOverscan)
+	{
+		if (iOverscan == aOverscan)
+			return;
+		iOverscan = aOverscan;
+		realise();
+	}
+
+	dimension virtualised_container::estimated_item_extent() const
+	{
+		if (iMeasuredCount != 0u)
+			return std::max(iMeasuredTotal / iMeasuredCount, 1.0);
+		if (iEstimatedExtent > 0.0)
+			return iEstimatedExtent;
+		return std::max(std::ceil(font().height()), 1.0);
+	}
+
+	void virtualised_container::set_estimated_item_extent(dimension aExtent)
+	{
+		iEstimatedExtent = aExtent;
+		iMeasuredTotal = 0.0;
+		iMeasuredCount = 0u;
+		update_scrollbar_visibility();
+	}
+
+	std::size_t virtualised_container::widget_count() const
+	{
+		return iLive.size() + iPool.size();
+	}
+
+	void virtualised_container::make_visible(item_index aIndex)
+	{
+		if (aIndex >= iItemCount)
+			return;
+		scoped_units su{ *this, units::Pixels };
+		auto const cr = client_rect(false);
+		for (auto const& live : iLive)
+		{
+			if (live.first != aIndex)
+				continue;
+			auto const top = live.second->position().y;
+			auto const bottom = top + live.second->extents().cy;
+			if (top < cr.top())
+				vertical_scrollbar().set_position(vertical_scrollbar().position() - (cr.top() - top));
+			else if (bottom > cr.bottom())
+				vertical_scrollbar().set_position(vertical_scrollbar().position() + (bottom - cr.bottom()));
+			return;
+		}
+		vertical_scrollbar().set_position(aIndex * estimated_item_extent());
+	}
+
+	scrolling_disposition virtualised_container::scrolling_disposition() const
+	{
+		return neogfx::scrolling_disposition::ScrollChildWidgetVertically;
+	}
+
+	scrolling_disposition virtualised_container::scrolling_disposition(const i_widget&) const
+	{
+		return neogfx::scrolling_disposition::DontScrollChildWidget;
+	}
+
+	void virtualised_container::scrollbar_updated(const i_scrollbar& aScrollbar, i_scrollbar::update_reason_e aReason)
+	{
+		scrollable_widget::scrollbar_updated(aScrollbar, aReason);
+		if (aScrollbar.type() == scrollbar_type::Vertical)
+			realise();
+	}
+
+	void virtualised_container::update_scrollbar_visibility()
+	{
+		{
+			neolib::scoped_flag sf{ iRealising };
+			scrollable_widget::update_scrollbar_visibility();
+		}
+		realise();
+	}
+
+	void virtualised_container::update_scrollbar_visibility(usv_stage_e aStage)
+	{
+		scoped_units su{ *this, units::Pixels };
+		switch (aStage)
+		{
+		case UsvStageInit:
+			vertical_scrollbar().hide();
+			horizontal_scrollbar().hide();
+			break;
+		case UsvStageCheckVertical1:
+		case UsvStageCheckVertical2:
+			vertical_scrollbar().set_minimum(0.0);
+			vertical_scrollbar().set_maximum(total_extent());
+			vertical_scrollbar().set_step(estimated_item_extent());
+			vertical_scrollbar().set_page(std::max(units_converter(*this).to_device_units(client_rect(false)).cy, 0.0));
+			if (vertical_scrollbar().page() > 0 && vertical_scrollbar().maximum() - vertical_scrollbar().page() > 0.0)
+				vertical_scrollbar().show();
+			else
+				vertical_scrollbar().hide();
+			break;
+		default:
+			break;
+		}
+	}
+
+	void virtualised_container::realise()
+	{
+		if (iRealising)
+			return;
+		bool rescaled = false;
+		{
+			neolib::scoped_flag sf{ iRealising };
+			scoped_units su{ *this, units::Pixels };
+			auto const cr = client_rect(false);
+			live_list previous;
+			previous.swap(iLive);
+			if (iItemCount == 0u || cr.cy <= 0.0)
+			{
+				for (auto& live : previous)
+					recycle(live.second);
+				update();
+				return;
+			}
+			// the item at the top edge is found from the scroll position using the estimated extent, then the
+			// items around it are laid out using their measured extents
+			auto const oldEstimate = estimated_item_extent();
+			auto const position = vertical_scrollbar().visible() ? vertical_scrollbar().position() : 0.0;
+			auto const first = std::min(static_cast<item_index>(position / oldEstimate), iItemCount - 1u);
+			auto const offset = position - first * oldEstimate;
+			auto const nearest = first - std::min(first, iOverscan);
+			auto const furthest = static_cast<uint64_t>(first) + previous.size() + iOverscan;
+			for (auto& live : previous)
+				if (live.first < nearest || live.first > furthest)
+					recycle(std::move(live.second));
+			struct placement
+			{
+				item_index index;
+				std::shared_ptr<i_widget> widget;
+				coordinate y;
+				dimension cy;
+			};
+			std::deque<placement> placements;
+			auto place = [&](item_index aIndex, coordinate aY)
+			{
+				bool measure = false;
+				auto w = acquire(aIndex, previous, measure);
+				auto const cy = std::max(w->minimum_size(cr.extents()).cy, 1.0);
+				if (measure)
+				{
+					iMeasuredTotal += cy;
+					++iMeasuredCount;
+				}
+				return placement{ aIndex, w, aY, cy };
+			};
+			coordinate y = cr.top() - offset;
+			item_index next = first;
+			for (; next < iItemCount && y < cr.bottom(); ++next)
+			{
+				placements.push_back(place(next, y));
+				y += placements.back().cy;
+			}
+			for (uint32_t extra = 0u; extra < iOverscan && next < iItemCount; ++extra, ++next)
+			{
+				placements.push_back(place(next, y));
+				y += placements.back().cy;
+			}
+			if (next == iItemCount && y < cr.bottom())
+				for (auto& p : placements)
+					p.y += (cr.bottom() - y);
+			coordinate top = placements.front().y;
+			uint32_t extraAbove = 0u;
+			for (item_index index = first; index > 0u && (top > cr.top() || extraAbove < iOverscan);)
+			{
+				if (top <= cr.top())
+					++extraAbove;
+				placements.push_front(place(--index, top));
+				top -= placements.front().cy;
+				placements.front().y = top;
+			}
+			if (placements.front().index == 0u && placements.front().y > cr.top())
+			{
+				auto const adjust = placements.front().y - cr.top();
+				for (auto& p : placements)
+					p.y -= adjust;
+			}
+			for (auto& p : placements)
+			{
+				p.widget->move(point{ cr.x, p.y });
+				p.widget->resize(size{ cr.cx, p.cy });
+				p.widget->show();
+				iLive.emplace_back(p.index, p.widget);
+			}
+			for (auto& live : previous)
+				if (live.second != nullptr)
+					recycle(std::move(live.second));
+			while (iPool.size() > iLive.size())
+			{
+				remove(*iPool.back());
+				iPool.pop_back();
+			}
+			// keep the item at the top edge where it is when the estimate changes
+			auto const newEstimate = estimated_item_extent();
+			if (std::abs(newEstimate - oldEstimate) >= 1.0)
+			{
+				rescaled = true;
+				vertical_scrollbar().set_maximum(total_extent());
+				vertical_scrollbar().set_step(newEstimate);
+				if (vertical_scrollbar().visible())
+					vertical_scrollbar().set_position(first * newEstimate + offset);
+			}
+		}
+		if (rescaled && vertical_scrollbar().visible() != (vertical_scrollbar().maximum() - vertical_scrollbar().page() > 0.0))
+			update_scrollbar_visibility();
+		update();
+	}
+
+	std::shared_ptr<i_widget> virtualised_container::acquire(item_index aIndex, live_list& aPrevious, bool& aMeasure)
+	{
+		for (auto& live : aPrevious)
+			if (live.second != nullptr && live.first == aIndex)
+			{
+				aMeasure = false;
+				return std::move(live.second);
+			}
+		aMeasure = true;
+		std::shared_ptr<i_widget> recycled;
+		if (!iPool.empty())
+		{
+			recycled = iPool.back();
+			iPool.pop_back();
+		}
+		auto w = iFactory(aIndex, recycled);
+		if (w == nullptr)
+			throw no_widget();
+		if (recycled != nullptr && w != recycled)
+			remove(*recycled);
+		if (!w->has_parent() || &w->parent() != this)
+			add(w);
+		return w;
+	}
+
+	void virtualised_container::recycle(std::shared_ptr<i_widget> aWidget)
+	{
+		if (aWidget == nullptr)
+			return;
+		aWidget->hide();
+		iPool.push_back(aWidget);
+	}
+
+	void virtualised_container::recycle_all()
+	{
+		for (auto& live : iLive)
+			recycle(live.second);
+		iLive.clear();
+	}
+
+	dimension virtualised_container::total_extent() const
+	{
+		return iItemCount * estimated_item_extent();
+	}
+}
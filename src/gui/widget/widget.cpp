@@ -23,20 +23,146 @@
 #include <neogfx/app/app.hpp>
 #include <neogfx/gui/widget/widget.hpp>
 #include <neogfx/gui/layout/i_layout.hpp>
+#include <neogfx/gui/layout/layout_scheduler.hpp>
 #include <neogfx/hid/i_surface_window.hpp>
 
 namespace neogfx
 {
-	class widget::layout_timer : public pause_rendering, neolib::callback_timer
+	namespace
 	{
+		uint64_t sCulledWidgetTotal;
+
+		// true if the rectangles in aOccluders together cover aRect; gives up (returning false) if the
+		// uncovered region fragments into too many pieces
+		bool occluded(const rect& aRect, const std::vector<rect>& aOccluders)
+		{
+			const std::size_t MaxFragments = 32u;
+			thread_local std::vector<rect> region;
+			thread_local std::vector<rect> remainder;
+			region.assign(1, aRect);
+			for (const auto& occluder : aOccluders)
+			{
+				remainder.clear();
+				for (const auto& r : region)
+				{
+					const rect i = r.intersection(occluder);
+					if (i.empty())
+					{
+						remainder.push_back(r);
+						continue;
+					}
+					if (i.top() > r.top())
+						remainder.emplace_back(r.left(), r.top(), r.right(), i.top());
+					if (i.bottom() < r.bottom())
+						remainder.emplace_back(r.left(), i.bottom(), r.right(), r.bottom());
+					if (i.left() > r.left())
+						remainder.emplace_back(r.left(), i.top(), i.left(), i.bottom());
+					if (i.right() < r.right())
+						remainder.emplace_back(i.right(), i.top(), r.right(), i.bottom());
+				}
+				region.swap(remainder);
+				if (region.empty())
+					return true;
+				if (region.size() > MaxFragments)
+					return false;
+			}
+			return false;
+		}
+	}
+
+	class widget::spatial_index
+	{
+	public:
+		static const std::size_t Threshold = 64u;
+		static const uint32_t MaxCells = 256u;
+	public:
+		spatial_index() :
+			iStale{ true }, iColumns{ 0u }, iRows{ 0u }
+		{
+		}
 	public:
-		layout_timer(i_window& aWindow, neolib::async_task& aIoTask, std::function<void(callback_timer&)> aCallback) :
-			pause_rendering{ aWindow }, neolib::callback_timer{ aIoTask, aCallback, 0 }
+		bool stale() const
 		{
+			return iStale || iRects.empty();
 		}
-		~layout_timer()
+		void invalidate()
 		{
+			iStale = true;
 		}
+		void build(const widget& aOwner)
+		{
+			iStale = false;
+			const auto& children = aOwner.children();
+			iRects.clear();
+			iRects.reserve(children.size());
+			for (const auto& c : children)
+				iRects.push_back(aOwner.to_client_coordinates(c->non_client_rect()));
+			iBounds = iRects.front();
+			for (const auto& r : iRects)
+				iBounds = iBounds.combine(r);
+			iColumns = iRows = std::min(MaxCells, std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(iRects.size()))))));
+			iCellExtents = size{ std::max(iBounds.cx / iColumns, 1.0), std::max(iBounds.cy / iRows, 1.0) };
+			iCells.assign(iColumns * iRows, std::vector<uint32_t>{});
+			for (uint32_t i = 0u; i < iRects.size(); ++i)
+			{
+				const auto& r = iRects[i];
+				if (r.cx <= 0.0 || r.cy <= 0.0)
+					continue;
+				const uint32_t x0 = column(r.left());
+				const uint32_t x1 = column(r.right());
+				const uint32_t y0 = row(r.top());
+				const uint32_t y1 = row(r.bottom());
+				for (uint32_t y = y0; y <= y1; ++y)
+					for (uint32_t x = x0; x <= x1; ++x)
+						iCells[y * iColumns + x].push_back(i);
+			}
+		}
+		const i_widget* find(const widget& aOwner, const point& aPosition) const
+		{
+			if (!iBounds.contains(aPosition))
+				return nullptr;
+			const auto& children = aOwner.children();
+			// candidates are held in child order so the first match is the one a linear search would find
+			for (auto i : iCells[row(aPosition.y) * iColumns + column(aPosition.x)])
+				if (children[i]->visible() && iRects[i].contains(aPosition))
+					return &*children[i];
+			return nullptr;
+		}
+		// indexes (in child order) of the children whose rectangles intersect aRect
+		void find(const rect& aRect, std::vector<uint32_t>& aResult) const
+		{
+			aResult.clear();
+			if (iBounds.intersection(aRect).empty())
+				return;
+			const uint32_t x0 = column(aRect.left());
+			const uint32_t x1 = column(aRect.right());
+			const uint32_t y0 = row(aRect.top());
+			const uint32_t y1 = row(aRect.bottom());
+			for (uint32_t y = y0; y <= y1; ++y)
+				for (uint32_t x = x0; x <= x1; ++x)
+					for (auto i : iCells[y * iColumns + x])
+						if (!iRects[i].intersection(aRect).empty())
+							aResult.push_back(i);
+			std::sort(aResult.begin(), aResult.end());
+			aResult.erase(std::unique(aResult.begin(), aResult.end()), aResult.end());
+		}
+	private:
+		uint32_t column(coordinate aX) const
+		{
+			return static_cast<uint32_t>(std::min(std::max((aX - iBounds.x) / iCellExtents.cx, 0.0), iColumns - 1.0));
+		}
+		uint32_t row(coordinate aY) const
+		{
+			return static_cast<uint32_t>(std::min(std::max((aY - iBounds.y) / iCellExtents.cy, 0.0), iRows - 1.0));
+		}
+	private:
+		bool iStale;
+		rect iBounds;
+		size iCellExtents;
+		uint32_t iColumns;
+		uint32_t iRows;
+		std::vector<rect> iRects;
+		std::vector<std::vector<uint32_t>> iCells;
 	};
 
 	i_widget* widget::debug;
@@ -93,11 +219,12 @@ namespace neogfx
 			parent().remove(*this);
 		if (has_parent_layout())
 			parent_layout().remove(*this);
+		layout_scheduler::instance().remove(*this);
 	}
 
 	void widget::property_changed(i_property& aProperty)
 	{
-		static auto invalidate_layout = [](i_widget& self) { if (self.has_parent_layout()) self.parent_layout().invalidate(); self.update(true); };
+		static auto invalidate_layout = [](i_widget& self) { if (self.has_parent()) self.parent().child_geometry_changed(self); if (self.has_parent_layout()) self.parent_layout().invalidate(); self.update(true); };
 		static auto invalidate_canvas = [](i_widget& self) { self.update(true); };
 		static auto ignore = [](i_widget&) {};
 		static const std::unordered_map<std::type_index, std::function<void(i_widget&)>> sActions =
@@ -236,6 +363,7 @@ namespace neogfx
 		if (oldParent != nullptr)
 			aChild = oldParent->remove(*aChild, true);
 		iChildren.push_back(aChild);
+		child_geometry_changed(*aChild);
 		aChild->set_parent(*this);
 		aChild->set_singular(false);
 		if (has_root())
@@ -250,6 +378,7 @@ namespace neogfx
 			return std::shared_ptr<i_widget>{};
 		auto keep = *existing;
 		iChildren.erase(existing);
+		child_geometry_changed(*keep);
 		if (aSingular)
 			keep->set_singular(true);
 		if (has_layout())
@@ -593,8 +722,7 @@ namespace neogfx
 			return;
 		if (!aDefer)
 		{
-			if (iLayoutTimer != nullptr)
-				iLayoutTimer.reset();
+			layout_scheduler::instance().cancel(*this);
 			if (has_layout())
 			{
 				layout_items_started();
@@ -633,18 +761,9 @@ namespace neogfx
 		}
 		else if (can_defer_layout())
 		{
-			if (has_root() && !iLayoutTimer)
-			{
-				iLayoutTimer = std::make_unique<layout_timer>(root(), app::instance(), [this](neolib::callback_timer&)
-				{
-					if (root().has_native_window())
-					{
-						auto t = std::move(iLayoutTimer);
-						layout_items();
-						update();
-					}
-				});
-			}
+			if (has_parent_layout())
+				layout_item_proxy().invalidate_size_hints();
+			layout_scheduler::instance().schedule(*this);
 		}
 		else if (has_managing_layout())
 		{
@@ -655,6 +774,7 @@ namespace neogfx
 	void widget::layout_items_started()
 	{
 		++iLayoutInProgress;
+		layout_pass_started();
 	}
 
 	bool widget::layout_items_in_progress() const
@@ -664,6 +784,7 @@ namespace neogfx
 
 	void widget::layout_items_completed()
 	{
+		layout_pass_completed();
 		if (--iLayoutInProgress == 0)
 		{
 			layout_completed.trigger();
@@ -731,6 +852,8 @@ namespace neogfx
 		{
 			update(true);
 			Position.assign(units_converter(*this).to_device_units(aPosition), false);
+			if (has_parent())
+				parent().child_geometry_changed(*this);
 			update(true);
 			moved();
 		}
@@ -757,6 +880,8 @@ namespace neogfx
 		{
 			update();
 			Size.assign(units_converter(*this).to_device_units(aSize), false);
+			if (has_parent())
+				parent().child_geometry_changed(*this);
 			update();
 			resized();
 		}
@@ -768,6 +893,26 @@ namespace neogfx
 		layout_items();
 	}
 
+	void widget::child_geometry_changed(const i_widget&)
+	{
+		if (iSpatialIndex != nullptr)
+			iSpatialIndex->invalidate();
+	}
+
+	const widget::spatial_index* widget::child_spatial_index() const
+	{
+		if (children().size() < spatial_index::Threshold)
+		{
+			iSpatialIndex.reset();
+			return nullptr;
+		}
+		if (iSpatialIndex == nullptr)
+			iSpatialIndex = std::make_unique<spatial_index>();
+		if (iSpatialIndex->stale())
+			iSpatialIndex->build(*this);
+		return &*iSpatialIndex;
+	}
+
 	rect widget::non_client_rect() const
 	{
 		return rect{origin(), extents()};
@@ -785,6 +930,14 @@ namespace neogfx
 	{
 		if (client_rect().contains(aPosition))
 		{
+			auto index = child_spatial_index();
+			if (index != nullptr)
+			{
+				auto c = index->find(*this, aPosition);
+				if (c != nullptr)
+					return c->get_widget_at(aPosition - c->position());
+				return *this;
+			}
 			for (const auto& c : children())
 				if (c->visible() && to_client_coordinates(c->non_client_rect()).contains(aPosition))
 					return c->get_widget_at(aPosition - c->position());
@@ -1000,7 +1153,7 @@ namespace neogfx
 
 	bool widget::ready_to_render() const
 	{
-		return iLayoutTimer == nullptr;
+		return !layout_scheduler::instance().is_scheduled(*this);
 	}
 
 	void widget::render(graphics_context& aGraphicsContext) const
@@ -1039,9 +1192,57 @@ namespace neogfx
 			paint(aGraphicsContext);
 			painted.trigger(aGraphicsContext);
 
-			for (auto i = iChildren.rbegin(); i != iChildren.rend(); ++i)
+			// children are drawn back to front (last to first); walk them front to back first so that
+			// those entirely hidden behind opaque siblings can be skipped; only the opaque siblings in
+			// front of a child that overlap it (found with the spatial index if there is one) are tested
+			const auto index = child_spatial_index();
+			std::vector<bool> culled(iChildren.size(), false);
+			std::vector<rect> opaqueRects(iChildren.size());
+			std::vector<bool> opaqueChildren(iChildren.size(), false);
+			std::vector<uint32_t> candidates;
+			std::vector<rect> occluders;
+			for (std::size_t i = 0; i < iChildren.size(); ++i)
+			{
+				const auto& c = iChildren[i];
+				if (c->effectively_hidden())
+					continue;
+				rect intersection = clipRect.intersection(to_client_coordinates(c->non_client_rect()));
+				if (intersection.empty())
+					continue;
+				occluders.clear();
+				if (index != nullptr)
+				{
+					index->find(intersection, candidates);
+					for (auto j : candidates)
+					{
+						if (j >= i)
+							break;
+						if (opaqueChildren[j])
+							occluders.push_back(opaqueRects[j]);
+					}
+				}
+				else
+				{
+					for (std::size_t j = 0; j < i; ++j)
+						if (opaqueChildren[j] && !opaqueRects[j].intersection(intersection).empty())
+							occluders.push_back(opaqueRects[j]);
+				}
+				if (!occluders.empty() && occluded(intersection, occluders))
+				{
+					culled[i] = true;
+					++sCulledWidgetTotal;
+				}
+				else if (c->opaque())
+				{
+					opaqueChildren[i] = true;
+					opaqueRects[i] = intersection;
+				}
+			}
+			for (std::size_t i = iChildren.size(); i-- > 0;)
 			{
-				const auto& c = *i;
+				const auto& c = iChildren[i];
+				if (culled[i])
+					continue;
 				rect intersection = clipRect.intersection(to_client_coordinates(c->non_client_rect()));
 				if (!intersection.empty())
 					c->render(aGraphicsContext);
@@ -1063,6 +1264,16 @@ namespace neogfx
 		return !is_root();
 	}
 
+	bool widget::opaque() const
+	{
+		return (has_background_colour() || !transparent_background()) && background_colour().alpha() == 0xFF && opacity() == 1.0;
+	}
+
+	uint64_t widget::culled_widget_total()
+	{
+		return sCulledWidgetTotal;
+	}
+
 	void widget::paint_non_client(graphics_context& aGraphicsContext) const
 	{
 		if (has_background_colour() || !transparent_background())
@@ -108,6 +108,23 @@ namespace neogfx
 		}
 	}
 
+	bool opengl_window::scroll(const rect& aScrolledArea, const point& aDelta)
+	{
+		// the copy is applied to the previous frame at the start of the next render so it can only be
+		// accepted if nothing inside the scrolled area has been invalidated in pre-scroll coordinates
+		if (iFrameBufferSize == size{} || iLogicalCoordinateSystem != neogfx::logical_coordinate_system::AutomaticGui)
+			return false;
+		if (iPendingScroll != std::nullopt && iPendingScroll->first != aScrolledArea)
+			return false;
+		if (has_invalidated_area() && !invalidated_area().intersection(aScrolledArea).empty())
+			return false;
+		if (iPendingScroll == std::nullopt)
+			iPendingScroll = std::make_pair(aScrolledArea, aDelta);
+		else
+			iPendingScroll->second += aDelta;
+		return true;
+	}
+
 	bool opengl_window::has_invalidated_area() const
 	{
 		return iInvalidatedArea != std::nullopt;
@@ -155,18 +172,20 @@ namespace neogfx
 				return;
 		}
 
-		if (!has_invalidated_area())
+		if (!has_invalidated_area() && iPendingScroll == std::nullopt)
 			return;
 
-		if (invalidated_area().cx <= 0.0 || invalidated_area().cy <= 0.0)
+		if (has_invalidated_area() && (invalidated_area().cx <= 0.0 || invalidated_area().cy <= 0.0))
 		{
 			validate();
-			return;
+			if (iPendingScroll == std::nullopt)
+				return;
 		}
 
 		//std::cerr << "to render: " << rectToRender << std::endl;
 
 		++iFrameCounter;
+		rendering_engine().font_manager().advance_glyph_cache_frame();
 
 		iRendering = true;
 		iLastFrameTime = now;
@@ -180,7 +199,8 @@ namespace neogfx
 		glCheck(glEnable(GL_BLEND));
 		glCheck(glEnable(GL_DEPTH_TEST));
 		glCheck(glDepthFunc(GL_LEQUAL));
-		if (iFrameBufferSize.cx < static_cast<double>(extents().cx) || iFrameBufferSize.cy < static_cast<double>(extents().cy))
+		const bool newFrameBuffer = (iFrameBufferSize.cx < static_cast<double>(extents().cx) || iFrameBufferSize.cy < static_cast<double>(extents().cy));
+		if (newFrameBuffer)
 		{
 			if (iFrameBufferSize != size{})
 			{
@@ -217,9 +237,35 @@ namespace neogfx
 		GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0 };
 		glCheck(glDrawBuffers(sizeof(drawBuffers) / sizeof(drawBuffers[0]), drawBuffers));
 
-		glCheck(surface_window().native_window_render(invalidated_area()));
+		std::vector<rect> renderAreas;
+		if (iPendingScroll != std::nullopt)
+		{
+			const rect& scrolledArea = iPendingScroll->first;
+			const point& scrollDelta = iPendingScroll->second;
+			const rect copiedArea = newFrameBuffer ? rect{} : scrolledArea.intersection(scrolledArea + scrollDelta);
+			if (!copiedArea.empty())
+			{
+				copy_scrolled_area(copiedArea - scrollDelta, copiedArea);
+				if (scrollDelta.x != 0.0)
+					renderAreas.push_back(rect{ point{ scrollDelta.x > 0.0 ? scrolledArea.x : scrolledArea.right() + scrollDelta.x, scrolledArea.y }, size{ std::abs(scrollDelta.x), scrolledArea.cy } });
+				if (scrollDelta.y != 0.0)
+					renderAreas.push_back(rect{ point{ scrolledArea.x, scrollDelta.y > 0.0 ? scrolledArea.y : scrolledArea.bottom() + scrollDelta.y }, size{ scrolledArea.cx, std::abs(scrollDelta.y) } });
+			}
+			else
+				renderAreas.push_back(scrolledArea);
+			iPendingScroll = std::nullopt;
+		}
+		if (has_invalidated_area())
+			renderAreas.push_back(invalidated_area());
 
-		rendering_engine().vertex_arrays().execute();
+		// each area is rendered as a separate pass so that the strips exposed by a scroll are not merged
+		// with unrelated invalidations into a single bounding rectangle
+		for (const auto& renderArea : renderAreas)
+		{
+			iInvalidatedArea = renderArea;
+			glCheck(surface_window().native_window_render(invalidated_area()));
+			rendering_engine().vertex_arrays().execute();
+		}
 
 		glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
 		glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, iFrameBuffer));
@@ -228,7 +274,8 @@ namespace neogfx
 		display();
 
 		iRendering = false;
-		validate();
+		if (has_invalidated_area())
+			validate();
 
 		surface_window().rendering_finished.trigger();
 
@@ -264,6 +311,45 @@ namespace neogfx
 		return iFrameBufferSize;
 	}
 
+	void opengl_window::copy_scrolled_area(const rect& aSource, const rect& aDestination)
+	{
+		// blits within the same framebuffer are undefined if the rectangles overlap so the source is
+		// first copied to a scratch buffer with the same format and sample count as the frame buffer
+		if (iScrollBufferSize != iFrameBufferSize)
+		{
+			if (iScrollBufferSize != size{})
+			{
+				glCheck(glDeleteTextures(1, &iScrollBufferTexture));
+				glCheck(glDeleteFramebuffers(1, &iScrollBuffer));
+			}
+			iScrollBufferSize = iFrameBufferSize;
+			glCheck(glGenFramebuffers(1, &iScrollBuffer));
+			glCheck(glBindFramebuffer(GL_FRAMEBUFFER, iScrollBuffer));
+			glCheck(glGenTextures(1, &iScrollBufferTexture));
+			glCheck(glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, iScrollBufferTexture));
+			glCheck(glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4, GL_RGBA8, static_cast<GLsizei>(iScrollBufferSize.cx), static_cast<GLsizei>(iScrollBufferSize.cy), true));
+			glCheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, iScrollBufferTexture, 0));
+			GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+			if (status != GL_NO_ERROR && status != GL_FRAMEBUFFER_COMPLETE)
+				throw failed_to_create_framebuffer(status);
+			glCheck(glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, iFrameBufferTexture));
+		}
+		const GLint cx = static_cast<GLint>(aSource.cx);
+		const GLint cy = static_cast<GLint>(aSource.cy);
+		const GLint sourceX = static_cast<GLint>(aSource.x);
+		const GLint sourceY = static_cast<GLint>(extents().cy - aSource.bottom());
+		const GLint destinationX = static_cast<GLint>(aDestination.x);
+		const GLint destinationY = static_cast<GLint>(extents().cy - aDestination.bottom());
+		glCheck(glDisable(GL_SCISSOR_TEST));
+		glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, iFrameBuffer));
+		glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, iScrollBuffer));
+		glCheck(glBlitFramebuffer(sourceX, sourceY, sourceX + cx, sourceY + cy, 0, 0, cx, cy, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+		glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, iScrollBuffer));
+		glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, iFrameBuffer));
+		glCheck(glBlitFramebuffer(0, 0, cx, cy, destinationX, destinationY, destinationX + cx, destinationY + cy, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+		glCheck(glBindFramebuffer(GL_FRAMEBUFFER, iFrameBuffer));
+	}
+
 	bool opengl_window::metrics_available() const
 	{
 		return true;
@@ -289,6 +375,12 @@ namespace neogfx
 			glCheck(glDeleteTextures(1, &iFrameBufferTexture));
 			glCheck(glDeleteFramebuffers(1, &iFrameBuffer));
 		}
+		if (iScrollBufferSize != size{})
+		{
+			rendering_engine().activate_context(*this);
+			glCheck(glDeleteTextures(1, &iScrollBufferTexture));
+			glCheck(glDeleteFramebuffers(1, &iScrollBuffer));
+		}
 	}
 
 	void opengl_window::set_destroyed()
@@ -57,6 +57,7 @@ namespace neogfx
 		double fps() const override;
 	public:
 		void invalidate(const rect& aInvalidatedRect) override;
+		bool scroll(const rect& aScrolledArea, const point& aDelta) override;
 		bool has_invalidated_area() const override;
 		const rect& invalidated_area() const override;
 		rect validate() override;
@@ -76,6 +77,7 @@ namespace neogfx
 		void set_destroyed() override;
 	private:
 		virtual void display() = 0;
+		void copy_scrolled_area(const rect& aSource, const rect& aDestination);
 	private:
 		i_surface_window& iSurfaceWindow;
 		neogfx::logical_coordinate_system iLogicalCoordinateSystem;
@@ -84,7 +86,11 @@ namespace neogfx
 		GLuint iFrameBufferTexture;
 		GLuint iDepthStencilBuffer;
 		size iFrameBufferSize;
+		GLuint iScrollBuffer;
+		GLuint iScrollBufferTexture;
+		size iScrollBufferSize;
 		std::optional<rect> iInvalidatedArea;
+		std::optional<std::pair<rect, point>> iPendingScroll;
 		uint64_t iFrameCounter;
 		std::optional<uint32_t> iFrameRate;
 		uint64_t iLastFrameTime;
@@ -184,6 +184,7 @@ namespace neogfx
 		iParentWindow{ nullptr },
 		iClosed{ false },
 		iTitleText{ aWindowTitle },
+		iCulledWidgetCount{ 0u },
 		iStyle{ aStyle },
 		iCountedEnable{ 0 },
 		iEnteredWidget{ nullptr },
@@ -682,7 +683,9 @@ namespace neogfx
 				aGraphicsContext.fill_rounded_rect(shadowRect, dpi_scale(point{ 4.0, 4.0 }).x, colour::Yellow);
 			}
 		}
+		const auto culledBefore = culled_widget_total();
 		scrollable_widget::render(aGraphicsContext);
+		iCulledWidgetCount = static_cast<uint32_t>(culled_widget_total() - culledBefore);
 		aGraphicsContext.set_extents(extents());
 		aGraphicsContext.set_origin(origin());
 		paint_overlay.trigger(aGraphicsContext);
@@ -696,6 +699,11 @@ namespace neogfx
 		scrollable_widget::paint(aGraphicsContext);
 	}
 
+	uint32_t window::culled_widget_count() const
+	{
+		return iCulledWidgetCount;
+	}
+
 	colour window::background_colour() const
 	{
 		if (has_background_colour())
@@ -67,6 +67,7 @@ namespace neogfx
 		virtual double fps() const = 0;
 	public:
 		virtual void invalidate(const rect& aInvalidatedRect) = 0;
+		virtual bool scroll(const rect& aScrolledArea, const point& aDelta) = 0;
 		virtual bool has_invalidated_area() const = 0;
 		virtual const rect& invalidated_area() const = 0;
 		virtual rect validate() = 0;
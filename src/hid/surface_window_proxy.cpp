@@ -208,6 +208,11 @@ namespace neogfx
 			as_widget().update(aInvalidatedRect);
 	}
 
+	bool surface_window_proxy::scroll_surface(const rect& aScrolledArea, const point& aDelta)
+	{
+		return has_native_surface() && native_surface().scroll(aScrolledArea, aDelta);
+	}
+
 	bool surface_window_proxy::has_invalidated_area() const
 	{
 		return native_surface().has_invalidated_area();